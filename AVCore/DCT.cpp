@@ -10,7 +10,212 @@
 #include "DCT.hpp"
 #include "SIMD.hpp"
 
+#include <array>
+#include <cmath>
+#include <cstring>
+
 namespace SubIT {
+
+    // Float arithmetic for the lane kernels below, a "sample" is either one float or 8 AVX lanes.
+    struct SbFloatScalarOps {
+        using Type = float;
+        static inline Type Set(float c)          { return c; }
+        static inline Type Add(Type x, Type y)   { return x + y; }
+        static inline Type Sub(Type x, Type y)   { return x - y; }
+        static inline Type Mul(Type c, Type x)   { return c * x; }
+    };
+
+#if SB_SIMD_X86 >= SB_SIMD_X86_AVX
+    struct SbFloatAVXOps {
+        using Type = __m256;
+        static inline Type Set(float c)          { return _mm256_set1_ps(c); }
+        static inline Type Add(Type x, Type y)   { return _mm256_add_ps(x, y); }
+        static inline Type Sub(Type x, Type y)   { return _mm256_sub_ps(x, y); }
+        static inline Type Mul(Type c, Type x)   { return _mm256_mul_ps(c, x); }
+    };
+#endif
+
+    // Odd half of an orthonormal N-point DCT: M[k][n] = sqrt(2/N) * cos(pi * (2n+1) * (2k+1) / 2N).
+    template <size_t N>
+    static inline const float* OddHalfMatrix() {
+        static const std::array<float, (N >> 1) * (N >> 1)> m = [] {
+            std::array<float, (N >> 1) * (N >> 1)> r = {};
+            for (size_t k = 0; k != (N >> 1); ++k) {
+                for (size_t n = 0; n != (N >> 1); ++n) {
+                    r[k * (N >> 1) + n] = static_cast<float>(std::sqrt(2.0 / N) * std::cos(3.14159265358979323846 * static_cast<double>((2 * n + 1) * (2 * k + 1)) / (2.0 * N)));
+                }
+            }
+            return r;
+        }();
+        return m.data();
+    }
+
+    // v[i] is sample i, every lane is transformed independently.
+    // 8 points use the same butterflies as SbDCT::Transform8. Bigger sizes split into even and odd halves,
+    // the even half (sums) is a half sized DCT and the odd half (differences) is a small matrix product.
+    template <size_t N, class Ops, bool Dir>
+    static inline void FloatTransformLanes(typename Ops::Type* v) {
+        using T = typename Ops::Type;
+        if constexpr (N == 4) {
+            // Same butterflies as SbDCT::Transform4.
+            const T a = Ops::Set(0.5F), b = Ops::Set(0.270598F), c = Ops::Set(0.653281F);
+            const auto rl = [](T cr, T sr, T x, T y) { return Ops::Sub(Ops::Mul(cr, x), Ops::Mul(sr, y)); };
+            const auto rh = [](T cr, T sr, T x, T y) { return Ops::Add(Ops::Mul(sr, x), Ops::Mul(cr, y)); };
+            if constexpr (Dir == SbDCT::dirForward) {
+                const T e0 = Ops::Add(v[0], v[3]), e1 = Ops::Add(v[1], v[2]);
+                const T d0 = Ops::Sub(v[0], v[3]), d1 = Ops::Sub(v[1], v[2]);
+                v[0] = rh(a, a, e0, e1);
+                v[1] = rh(b, c, d0, d1);
+                v[2] = rl(a, a, e0, e1);
+                v[3] = rl(b, c, d0, d1);
+            }
+            else if constexpr (Dir == SbDCT::dirInverse) {
+                const T t0 = rl(a, a, v[0], v[2]), t1 = rh(a, a, v[0], v[2]);
+                const T t2 = rl(b, c, v[1], v[3]), t3 = rh(b, c, v[1], v[3]);
+                v[0] = Ops::Add(t1, t3);
+                v[1] = Ops::Add(t0, t2);
+                v[2] = Ops::Sub(t0, t2);
+                v[3] = Ops::Sub(t1, t3);
+            }
+        }
+        else if constexpr (N == 8) {
+            const T a = Ops::Set(0.3535533905F), b = Ops::Set(0.4903926402F), c = Ops::Set(0.4157348061F);
+            const T d = Ops::Set(0.4619397662F), e = Ops::Set(0.0975451610F), f = Ops::Set(0.2777851165F);
+            const T g = Ops::Set(0.1913417161F);
+            // Rotate2D(cr, sr, x, y) = (cr * x - sr * y, sr * x + cr * y).
+            const auto rl = [](T cr, T sr, T x, T y) { return Ops::Sub(Ops::Mul(cr, x), Ops::Mul(sr, y)); };
+            const auto rh = [](T cr, T sr, T x, T y) { return Ops::Add(Ops::Mul(sr, x), Ops::Mul(cr, y)); };
+
+            if constexpr (Dir == SbDCT::dirForward) {
+                const T s0 = Ops::Add(v[0], v[7]), s1 = Ops::Sub(v[0], v[7]);
+                const T s2 = Ops::Add(v[1], v[6]), s3 = Ops::Sub(v[1], v[6]);
+                const T s4 = Ops::Add(v[2], v[5]), s5 = Ops::Sub(v[2], v[5]);
+                const T s6 = Ops::Add(v[3], v[4]), s7 = Ops::Sub(v[3], v[4]);
+                const T e0 = Ops::Add(s0, s6), e1 = Ops::Add(s2, s4);
+                const T e2 = Ops::Sub(s2, s4), e3 = Ops::Sub(s0, s6);
+                const T r0 = rl(b, e, s7, s1), r1 = rh(b, e, s7, s1);
+                const T r2 = rl(c, f, s5, s3), r3 = rh(c, f, s5, s3);
+                const T t0 = rl(c, f, s1, s7), t1 = rh(c, f, s1, s7);
+                const T t2 = rl(b, e, s3, s5), t3 = rh(b, e, s3, s5);
+                v[0] = rh(a, a, e0, e1);
+                v[2] = rh(d, g, e2, e3);
+                v[4] = rl(a, a, e0, e1);
+                v[6] = Ops::Sub(Ops::Set(0.F), rl(d, g, e2, e3));
+                v[7] = Ops::Sub(r2, r0);
+                v[5] = Ops::Sub(t1, t2);
+                v[3] = Ops::Sub(t0, t3);
+                v[1] = Ops::Add(r1, r3);
+            }
+            else if constexpr (Dir == SbDCT::dirInverse) {
+                const T s1 = rl(a, a, v[0], v[4]), s0 = rh(a, a, v[0], v[4]);
+                const T s2 = rl(g, d, v[2], v[6]), s3 = rh(g, d, v[2], v[6]);
+                const T g0 = rl(e, b, v[1], v[7]), g1 = rh(e, b, v[1], v[7]);
+                const T g2 = rl(b, e, v[3], v[5]), g3 = rh(b, e, v[3], v[5]);
+                const T g4 = rl(c, f, v[1], v[7]), g5 = rh(c, f, v[1], v[7]);
+                const T g6 = rl(f, c, v[3], v[5]), g7 = rh(f, c, v[3], v[5]);
+                const T t0 = Ops::Add(g1, g7), t1 = Ops::Sub(g3, g4);
+                const T t2 = Ops::Sub(g2, g5), t3 = Ops::Sub(g0, g6);
+                const T k0 = Ops::Add(s0, s3), k1 = Ops::Sub(s0, s3);
+                const T k2 = Ops::Add(s1, s2), k3 = Ops::Sub(s1, s2);
+                v[0] = Ops::Add(k0, t0);
+                v[2] = Ops::Sub(k3, t2);
+                v[4] = Ops::Sub(k1, t3);
+                v[6] = Ops::Add(k2, t1);
+                v[7] = Ops::Sub(k0, t0);
+                v[5] = Ops::Add(k3, t2);
+                v[3] = Ops::Add(k1, t3);
+                v[1] = Ops::Sub(k2, t1);
+            }
+        }
+        else {
+            constexpr size_t H = N >> 1;
+            const T      h = Ops::Set(0.7071067812F); // Even half is a H-point DCT scaled by 1/sqrt(2).
+            const float* m = OddHalfMatrix<N>();
+            T even[H], odd[H];
+            if constexpr (Dir == SbDCT::dirForward) {
+                for (size_t i = 0; i != H; ++i) {
+                    even[i] = Ops::Add(v[i], v[N - 1 - i]);
+                    odd [i] = Ops::Sub(v[i], v[N - 1 - i]);
+                }
+                FloatTransformLanes<H, Ops, Dir>(even);
+                for (size_t k = 0; k != H; ++k) {
+                    T acc = Ops::Mul(Ops::Set(m[k * H]), odd[0]);
+                    for (size_t n = 1; n != H; ++n) { acc = Ops::Add(acc, Ops::Mul(Ops::Set(m[k * H + n]), odd[n])); }
+                    v[2 * k + 0] = Ops::Mul(h, even[k]);
+                    v[2 * k + 1] = acc;
+                }
+            }
+            else if constexpr (Dir == SbDCT::dirInverse) {
+                for (size_t n = 0; n != H; ++n) {
+                    T acc = Ops::Mul(Ops::Set(m[n]), v[1]);
+                    for (size_t k = 1; k != H; ++k) { acc = Ops::Add(acc, Ops::Mul(Ops::Set(m[k * H + n]), v[2 * k + 1])); }
+                    even[n] = Ops::Mul(h, v[2 * n]);
+                    odd [n] = acc;
+                }
+                FloatTransformLanes<H, Ops, Dir>(even);
+                for (size_t i = 0; i != H; ++i) {
+                    v[i]         = Ops::Add(even[i], odd[i]);
+                    v[N - 1 - i] = Ops::Sub(even[i], odd[i]);
+                }
+            }
+        }
+    }
+
+#if SB_SIMD_X86 >= SB_SIMD_X86_AVX
+    // NxN block with 8 lanes: rows are done 8 at a time through transposed 8x8 tiles, then columns 8 at a time.
+    template <size_t N, bool Dir>
+    static inline void FloatTransformNxN(float* src, ptrdiff_t step) {
+        __m256 v[N];
+        for (ptrdiff_t r = 0; r != N; r += 8) {
+            for (ptrdiff_t c = 0; c != N; c += 8) {
+                for (ptrdiff_t i = 0; i != 8; ++i) { v[c + i] = _mm256_loadu_ps(src + (r + i) * step + c); }
+                SbSIMD::Transpose8x8(v + c);
+            }
+            FloatTransformLanes<N, SbFloatAVXOps, Dir>(v);
+            for (ptrdiff_t c = 0; c != N; c += 8) {
+                SbSIMD::Transpose8x8(v + c);
+                for (ptrdiff_t i = 0; i != 8; ++i) { _mm256_storeu_ps(src + (r + i) * step + c, v[c + i]); }
+            }
+        }
+        for (ptrdiff_t c = 0; c != N; c += 8) {
+            for (ptrdiff_t i = 0; i != N; ++i) { v[i] = _mm256_loadu_ps(src + i * step + c); }
+            FloatTransformLanes<N, SbFloatAVXOps, Dir>(v);
+            for (ptrdiff_t i = 0; i != N; ++i) { _mm256_storeu_ps(src + i * step + c, v[i]); }
+        }
+    }
+#endif
+
+    // Eight NxN blocks interleaved, sample i of block b at src[i * 8 + b]. Every load is one sample of all blocks.
+    template <size_t N, bool Dir>
+    static inline void FloatTransformNxNx8(float* src) {
+#if SB_SIMD_X86 >= SB_SIMD_X86_AVX
+        __m256 v[N];
+        for (size_t r = 0; r != N; ++r) {
+            for (size_t c = 0; c != N; ++c) { v[c] = _mm256_load_ps(src + (r * N + c) * 8); }
+            FloatTransformLanes<N, SbFloatAVXOps, Dir>(v);
+            for (size_t c = 0; c != N; ++c) { _mm256_store_ps(src + (r * N + c) * 8, v[c]); }
+        }
+        for (size_t c = 0; c != N; ++c) {
+            for (size_t r = 0; r != N; ++r) { v[r] = _mm256_load_ps(src + (r * N + c) * 8); }
+            FloatTransformLanes<N, SbFloatAVXOps, Dir>(v);
+            for (size_t r = 0; r != N; ++r) { _mm256_store_ps(src + (r * N + c) * 8, v[r]); }
+        }
+#else
+        for (size_t b = 0; b != 8; ++b) {
+            float v[N];
+            for (size_t r = 0; r != N; ++r) {
+                for (size_t c = 0; c != N; ++c) { v[c] = src[(r * N + c) * 8 + b]; }
+                FloatTransformLanes<N, SbFloatScalarOps, Dir>(v);
+                for (size_t c = 0; c != N; ++c) { src[(r * N + c) * 8 + b] = v[c]; }
+            }
+            for (size_t c = 0; c != N; ++c) {
+                for (size_t r = 0; r != N; ++r) { v[r] = src[(r * N + c) * 8 + b]; }
+                FloatTransformLanes<N, SbFloatScalarOps, Dir>(v);
+                for (size_t r = 0; r != N; ++r) { src[(r * N + c) * 8 + b] = v[r]; }
+            }
+        }
+#endif
+    }
     
     SbDCT::SbDCT(float* beg, ptrdiff_t s) :src(beg), step(s) {}
     
@@ -114,12 +319,18 @@ namespace SubIT {
     
     template <bool Dir>
     void SbDCT::Transform16() {
-        // TODO: Implement it.
+        float v[16];
+        for (ptrdiff_t i = 0; i != 16; ++i) { v[i] = At(i); }
+        FloatTransformLanes<16, SbFloatScalarOps, Dir>(v);
+        for (ptrdiff_t i = 0; i != 16; ++i) { At(i) = v[i]; }
     }
     
     template <bool Dir>
     void SbDCT::Transform32() {
-        // TODO: Implement it.
+        float v[32];
+        for (ptrdiff_t i = 0; i != 32; ++i) { v[i] = At(i); }
+        FloatTransformLanes<32, SbFloatScalarOps, Dir>(v);
+        for (ptrdiff_t i = 0; i != 32; ++i) { At(i) = v[i]; }
     }
 
     template <bool Dir>
@@ -130,10 +341,8 @@ namespace SubIT {
     
     template <bool Dir>
     void SbDCT::Quantize8 (const float* const tb) {
-        if constexpr (Dir == dirForward) { SbSIMD::DivA4(src + 0, tb + 0);
-                                           SbSIMD::DivA4(src + 4, tb + 4); return; }
-        if constexpr (Dir == dirInverse) { SbSIMD::MulA4(src + 0, tb + 0);
-                                           SbSIMD::MulA4(src + 4, tb + 4); return; }
+        if constexpr (Dir == dirForward) { SbSIMD::DivA8(src, tb); return; }
+        if constexpr (Dir == dirInverse) { SbSIMD::MulA8(src, tb); return; }
     }
 
     template <bool Dir>
@@ -174,6 +383,12 @@ namespace SubIT {
     template void SbDCT2::Transform4x4<SbDCT::dirInverse>();
     template void SbDCT2::Transform8x8<SbDCT::dirForward>();
     template void SbDCT2::Transform8x8<SbDCT::dirInverse>();
+    template void SbDCT2::Transform8x8N<SbDCT::dirForward>(size_t);
+    template void SbDCT2::Transform8x8N<SbDCT::dirInverse>(size_t);
+    template void SbDCT2::Transform4x4x8<SbDCT::dirForward>();
+    template void SbDCT2::Transform4x4x8<SbDCT::dirInverse>();
+    template void SbDCT2::Transform8x8x8<SbDCT::dirForward>();
+    template void SbDCT2::Transform8x8x8<SbDCT::dirInverse>();
     template void SbDCT2::Transform16x16<SbDCT::dirForward>();
     template void SbDCT2::Transform16x16<SbDCT::dirInverse>();
     template void SbDCT2::Transform32x32<SbDCT::dirForward>();
@@ -182,6 +397,8 @@ namespace SubIT {
     template void SbDCT2::Quantize4x4<SbDCT::dirInverse>(const float* const);
     template void SbDCT2::Quantize8x8<SbDCT::dirForward>(const float* const);
     template void SbDCT2::Quantize8x8<SbDCT::dirInverse>(const float* const);
+    template void SbDCT2::Quantize8x8N<SbDCT::dirForward>(const float* const, size_t);
+    template void SbDCT2::Quantize8x8N<SbDCT::dirInverse>(const float* const, size_t);
     template void SbDCT2::Quantize16x16<SbDCT::dirForward>(const float* const);
     template void SbDCT2::Quantize16x16<SbDCT::dirInverse>(const float* const);
     template void SbDCT2::Quantize32x32<SbDCT::dirForward>(const float* const);
@@ -202,6 +419,16 @@ namespace SubIT {
     
     template <bool Dir>
     void SbDCT2::Transform8x8() {
+#if SB_SIMD_X86 >= SB_SIMD_X86_AVX
+        // Rows are transformed after the first transpose, columns after the second one.
+        __m256 v[8];
+        for (ptrdiff_t i = 0; i != 8; ++i) { v[i] = _mm256_loadu_ps(src + i * step); }
+        SbSIMD::Transpose8x8(v);
+        FloatTransformLanes<8, SbFloatAVXOps, Dir>(v);
+        SbSIMD::Transpose8x8(v);
+        FloatTransformLanes<8, SbFloatAVXOps, Dir>(v);
+        for (ptrdiff_t i = 0; i != 8; ++i) { _mm256_storeu_ps(src + i * step, v[i]); }
+#else
         SbDCT row0(src + 0 * step, 1); row0.Transform8<Dir>(); 
         SbDCT row1(src + 1 * step, 1); row1.Transform8<Dir>();
         SbDCT row2(src + 2 * step, 1); row2.Transform8<Dir>();
@@ -219,10 +446,38 @@ namespace SubIT {
         SbDCT col5(src + 5, step); col5.Transform8<Dir>();
         SbDCT col6(src + 6, step); col6.Transform8<Dir>();
         SbDCT col7(src + 7, step); col7.Transform8<Dir>();
+#endif
+    }
+
+    template <bool Dir>
+    void SbDCT2::Transform8x8N(size_t n) {
+        for (SbDCT2 block(src, step); n != 0; --n, block.src += 8) {
+            block.Transform8x8<Dir>();
+        }
+    }
+
+    template <bool Dir>
+    void SbDCT2::Transform4x4x8() {
+        FloatTransformNxNx8<4, Dir>(src);
+    }
+
+    template <bool Dir>
+    void SbDCT2::Transform8x8x8() {
+        FloatTransformNxNx8<8, Dir>(src);
+    }
+
+    template <bool Dir>
+    void SbDCT2::Quantize8x8N(const float* const tb, size_t n) {
+        for (SbDCT2 block(src, step); n != 0; --n, block.src += 8) {
+            block.Quantize8x8<Dir>(tb);
+        }
     }
     
     template <bool Dir>
     void SbDCT2::Transform16x16() {
+#if SB_SIMD_X86 >= SB_SIMD_X86_AVX
+        FloatTransformNxN<16, Dir>(src, step);
+#else
         SbDCT row0 (src + 0  * step, 1); row0 .Transform16<Dir>(); 
         SbDCT row1 (src + 1  * step, 1); row1 .Transform16<Dir>();
         SbDCT row2 (src + 2  * step, 1); row2 .Transform16<Dir>();
@@ -256,10 +511,14 @@ namespace SubIT {
         SbDCT col13(src + 13, step); col13.Transform16<Dir>();
         SbDCT col14(src + 14, step); col14.Transform16<Dir>();
         SbDCT col15(src + 15, step); col15.Transform16<Dir>();
+#endif
     }
     
     template <bool Dir>
     void SbDCT2::Transform32x32() {
+#if SB_SIMD_X86 >= SB_SIMD_X86_AVX
+        FloatTransformNxN<32, Dir>(src, step);
+#else
         SbDCT row0 (src + 0  * step, 1); row0 .Transform32<Dir>(); 
         SbDCT row1 (src + 1  * step, 1); row1 .Transform32<Dir>();
         SbDCT row2 (src + 2  * step, 1); row2 .Transform32<Dir>();
@@ -325,6 +584,7 @@ namespace SubIT {
         SbDCT col29(src + 29, step); col29.Transform32<Dir>();
         SbDCT col30(src + 30, step); col30.Transform32<Dir>();
         SbDCT col31(src + 31, step); col31.Transform32<Dir>();
+#endif
     }
     
     template <bool Dir> 
@@ -402,4 +662,162 @@ namespace SubIT {
         SbDCT row30(src + 30 * step); row30.Quantize32<Dir>(tb + (30 << 5));
         SbDCT row31(src + 31 * step); row31.Quantize32<Dir>(tb + (31 << 5));
     }
+
+    SbFixedDCT2::SbFixedDCT2(int16_t* beg, ptrdiff_t row_size) : src(beg), step(row_size) {}
+
+    template void SbFixedDCT2::Transform8x8<SbDCT::dirForward>();
+    template void SbFixedDCT2::Transform8x8<SbDCT::dirInverse>();
+    template void SbFixedDCT2::Transform8x8x2<SbDCT::dirForward>();
+    template void SbFixedDCT2::Transform8x8x2<SbDCT::dirInverse>();
+    template void SbFixedDCT2::Transform8x8N<SbDCT::dirForward>(size_t);
+    template void SbFixedDCT2::Transform8x8N<SbDCT::dirInverse>(size_t);
+    template void SbFixedDCT2::Quantize8x8<SbDCT::dirForward>(const int16_t* const);
+    template void SbFixedDCT2::Quantize8x8<SbDCT::dirInverse>(const int16_t* const);
+    template void SbFixedDCT2::Quantize8x8x2<SbDCT::dirForward>(const int16_t* const);
+    template void SbFixedDCT2::Quantize8x8x2<SbDCT::dirInverse>(const int16_t* const);
+    template void SbFixedDCT2::Quantize8x8N<SbDCT::dirForward>(const int16_t* const, size_t);
+    template void SbFixedDCT2::Quantize8x8N<SbDCT::dirInverse>(const int16_t* const, size_t);
+
+    // Integer arithmetic, scalar and AVX2 versions must agree on every single bit.
+    // Mul is a Q15 multiplication with rounding, exactly what _mm256_mulhrs_epi16 does.
+    struct SbFixedScalarOps {
+        using Type = int16_t;
+        static inline Type Set(int16_t c)        { return c; }
+        static inline Type Add(Type x, Type y)   { return static_cast<int16_t>(x + y); }
+        static inline Type Sub(Type x, Type y)   { return static_cast<int16_t>(x - y); }
+        static inline Type Mul(Type c, Type x)   { return static_cast<int16_t>((c * x + 0x4000) >> 15); }
+    };
+
+#if SB_SIMD_X86 >= SB_SIMD_X86_AVX2
+    struct SbFixedAVX2Ops {
+        using Type = __m256i;
+        static inline Type Set(int16_t c)        { return _mm256_set1_epi16(c); }
+        static inline Type Add(Type x, Type y)   { return _mm256_add_epi16(x, y); }
+        static inline Type Sub(Type x, Type y)   { return _mm256_sub_epi16(x, y); }
+        static inline Type Mul(Type c, Type x)   { return _mm256_mulhrs_epi16(c, x); }
+    };
+#endif
+
+    // Same butterflies as SbDCT::Transform8 with Q15 constants.
+    template <class Ops, bool Dir>
+    static inline void FixedTransform8Lanes(typename Ops::Type* v) {
+        using T = typename Ops::Type;
+        const T a = Ops::Set(11585), b = Ops::Set(16069), c = Ops::Set(13623), d = Ops::Set(15137);
+        const T e = Ops::Set(3196),  f = Ops::Set(9102),  g = Ops::Set(6270);
+        const auto rl = [](T cr, T sr, T x, T y) { return Ops::Sub(Ops::Mul(cr, x), Ops::Mul(sr, y)); };
+        const auto rh = [](T cr, T sr, T x, T y) { return Ops::Add(Ops::Mul(sr, x), Ops::Mul(cr, y)); };
+
+        if constexpr (Dir == SbDCT::dirForward) {
+            const T s0 = Ops::Add(v[0], v[7]), s1 = Ops::Sub(v[0], v[7]);
+            const T s2 = Ops::Add(v[1], v[6]), s3 = Ops::Sub(v[1], v[6]);
+            const T s4 = Ops::Add(v[2], v[5]), s5 = Ops::Sub(v[2], v[5]);
+            const T s6 = Ops::Add(v[3], v[4]), s7 = Ops::Sub(v[3], v[4]);
+            const T e0 = Ops::Add(s0, s6), e1 = Ops::Add(s2, s4);
+            const T e2 = Ops::Sub(s2, s4), e3 = Ops::Sub(s0, s6);
+            const T r0 = rl(b, e, s7, s1), r1 = rh(b, e, s7, s1);
+            const T r2 = rl(c, f, s5, s3), r3 = rh(c, f, s5, s3);
+            const T t0 = rl(c, f, s1, s7), t1 = rh(c, f, s1, s7);
+            const T t2 = rl(b, e, s3, s5), t3 = rh(b, e, s3, s5);
+            v[0] = rh(a, a, e0, e1);
+            v[2] = rh(d, g, e2, e3);
+            v[4] = rl(a, a, e0, e1);
+            v[6] = Ops::Sub(Ops::Set(0), rl(d, g, e2, e3));
+            v[7] = Ops::Sub(r2, r0);
+            v[5] = Ops::Sub(t1, t2);
+            v[3] = Ops::Sub(t0, t3);
+            v[1] = Ops::Add(r1, r3);
+        }
+        else if constexpr (Dir == SbDCT::dirInverse) {
+            const T s1 = rl(a, a, v[0], v[4]), s0 = rh(a, a, v[0], v[4]);
+            const T s2 = rl(g, d, v[2], v[6]), s3 = rh(g, d, v[2], v[6]);
+            const T g0 = rl(e, b, v[1], v[7]), g1 = rh(e, b, v[1], v[7]);
+            const T g2 = rl(b, e, v[3], v[5]), g3 = rh(b, e, v[3], v[5]);
+            const T g4 = rl(c, f, v[1], v[7]), g5 = rh(c, f, v[1], v[7]);
+            const T g6 = rl(f, c, v[3], v[5]), g7 = rh(f, c, v[3], v[5]);
+            const T t0 = Ops::Add(g1, g7), t1 = Ops::Sub(g3, g4);
+            const T t2 = Ops::Sub(g2, g5), t3 = Ops::Sub(g0, g6);
+            const T k0 = Ops::Add(s0, s3), k1 = Ops::Sub(s0, s3);
+            const T k2 = Ops::Add(s1, s2), k3 = Ops::Sub(s1, s2);
+            v[0] = Ops::Add(k0, t0);
+            v[2] = Ops::Sub(k3, t2);
+            v[4] = Ops::Sub(k1, t3);
+            v[6] = Ops::Add(k2, t1);
+            v[7] = Ops::Sub(k0, t0);
+            v[5] = Ops::Add(k3, t2);
+            v[3] = Ops::Add(k1, t3);
+            v[1] = Ops::Sub(k2, t1);
+        }
+    }
+
+    template <bool Dir>
+    void SbFixedDCT2::Transform8x8() {
+        // Rows first and columns next, the same order as the AVX2 path.
+        int16_t v[8];
+        for (ptrdiff_t i = 0; i != 8; ++i) {
+            std::memcpy(v, src + i * step, sizeof(v));
+            FixedTransform8Lanes<SbFixedScalarOps, Dir>(v);
+            std::memcpy(src + i * step, v, sizeof(v));
+        }
+        for (ptrdiff_t j = 0; j != 8; ++j) {
+            for (ptrdiff_t i = 0; i != 8; ++i) { v[i] = src[i * step + j]; }
+            FixedTransform8Lanes<SbFixedScalarOps, Dir>(v);
+            for (ptrdiff_t i = 0; i != 8; ++i) { src[i * step + j] = v[i]; }
+        }
+    }
+
+    template <bool Dir>
+    void SbFixedDCT2::Transform8x8x2() {
+#if SB_SIMD_X86 >= SB_SIMD_X86_AVX2
+        __m256i v[8];
+        for (ptrdiff_t i = 0; i != 8; ++i) { v[i] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i * step)); }
+        SbSIMD::Transpose8x8x2(v);
+        FixedTransform8Lanes<SbFixedAVX2Ops, Dir>(v);
+        SbSIMD::Transpose8x8x2(v);
+        FixedTransform8Lanes<SbFixedAVX2Ops, Dir>(v);
+        for (ptrdiff_t i = 0; i != 8; ++i) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(src + i * step), v[i]); }
+#else
+        SbFixedDCT2(src + 0, step).Transform8x8<Dir>();
+        SbFixedDCT2(src + 8, step).Transform8x8<Dir>();
+#endif
+    }
+
+    template <bool Dir>
+    void SbFixedDCT2::Transform8x8N(size_t n) {
+        SbFixedDCT2 block(src, step);
+        for (; n > 1; n -= 2, block.src += 16) { block.Transform8x8x2<Dir>(); }
+        if (n) { block.Transform8x8<Dir>(); }
+    }
+
+    template <bool Dir>
+    void SbFixedDCT2::Quantize8x8(const int16_t* const tb) {
+        for (ptrdiff_t i = 0; i != 8; ++i) {
+            for (ptrdiff_t j = 0; j != 8; ++j) {
+                int16_t& x = src[i * step + j];
+                if constexpr (Dir == SbDCT::dirForward) { x = SbFixedScalarOps::Mul(tb[i * 8 + j], x); }
+                if constexpr (Dir == SbDCT::dirInverse) { x = static_cast<int16_t>(x * tb[i * 8 + j]); }
+            }
+        }
+    }
+
+    template <bool Dir>
+    void SbFixedDCT2::Quantize8x8x2(const int16_t* const tb) {
+#if SB_SIMD_X86 >= SB_SIMD_X86_AVX2
+        for (ptrdiff_t i = 0; i != 8; ++i) {
+            __m256i* row = reinterpret_cast<__m256i*>(src + i * step);
+            const __m256i t = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(tb + i * 8)));
+            if constexpr (Dir == SbDCT::dirForward) { _mm256_storeu_si256(row, _mm256_mulhrs_epi16(_mm256_loadu_si256(row), t)); }
+            if constexpr (Dir == SbDCT::dirInverse) { _mm256_storeu_si256(row, _mm256_mullo_epi16(_mm256_loadu_si256(row), t)); }
+        }
+#else
+        SbFixedDCT2(src + 0, step).Quantize8x8<Dir>(tb);
+        SbFixedDCT2(src + 8, step).Quantize8x8<Dir>(tb);
+#endif
+    }
+
+    template <bool Dir>
+    void SbFixedDCT2::Quantize8x8N(const int16_t* const tb, size_t n) {
+        SbFixedDCT2 block(src, step);
+        for (; n > 1; n -= 2, block.src += 16) { block.Quantize8x8x2<Dir>(tb); }
+        if (n) { block.Quantize8x8<Dir>(tb); }
+    }
 }
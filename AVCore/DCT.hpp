@@ -8,6 +8,7 @@
 ///
 #pragma once
 #include <cstddef>
+#include <cstdint>
 
 namespace SubIT {
     
@@ -35,7 +36,7 @@ namespace SubIT {
         template <bool Dir> void Transform4();
         template <bool Dir> void Transform8();
         template <bool Dir> void Transform16();
-        template <bool Dir> void Transform32(); // Wait for a new quantization table.
+        template <bool Dir> void Transform32();
         
 
         // Since quantization is not related to column or row, we assume step is 1 here for performance.
@@ -68,10 +69,48 @@ namespace SubIT {
         template <bool Dir> void Transform16x16();
         template <bool Dir> void Transform32x32();
 
+        // Batched version, process n 8x8 blocks which are next to each other in a row.
+        template <bool Dir> void Transform8x8N(size_t n);
+        // Eight blocks in the lanes of one register, sample i of block b at src[i * 8 + b] (32 byte aligned), step is unused.
+        template <bool Dir> void Transform4x4x8();
+        template <bool Dir> void Transform8x8x8();
+
         template <bool Dir> void Quantize4x4(const float* const tb);
         template <bool Dir> void Quantize8x8(const float* const tb);
         template <bool Dir> void Quantize16x16(const float* const tb);
         template <bool Dir> void Quantize32x32(const float* const tb);
+
+        template <bool Dir> void Quantize8x8N(const float* const tb, size_t n);
+    };
+
+    //==========================================
+    // Fixed point (int16) 2D Cosine Transform
+    //==========================================
+    class SbFixedDCT2 {
+    public:
+        // Samples carry this many fractional bits, coefficients come out in the same scale.
+        static constexpr int fractionBits = 3;
+
+        int16_t   *src;
+        ptrdiff_t  step;
+
+        // Every operation is done with integers only, results are bit-exact on all machines.
+        SbFixedDCT2(int16_t* beg, ptrdiff_t row_size);
+        SbFixedDCT2(const SbFixedDCT2&)            = default;
+        SbFixedDCT2(SbFixedDCT2&&)                 = default;
+        SbFixedDCT2& operator=(const SbFixedDCT2&) = default;
+        SbFixedDCT2& operator=(SbFixedDCT2&&)      = default;
+        ~SbFixedDCT2() = default;
+
+        template <bool Dir> void Transform8x8();
+        // Two blocks next to each other, which fill all 16 lanes of an AVX2 register.
+        template <bool Dir> void Transform8x8x2();
+        template <bool Dir> void Transform8x8N(size_t n);
+
+        // Forward table holds Q15 reciprocals, inverse table holds step sizes, both in fraction bits scale.
+        template <bool Dir> void Quantize8x8(const int16_t* const tb);
+        template <bool Dir> void Quantize8x8x2(const int16_t* const tb);
+        template <bool Dir> void Quantize8x8N(const int16_t* const tb, size_t n);
     };
 
 }
@@ -8,6 +8,12 @@
 
 #include <cstdlib>
 #include <cstring>
+#include <algorithm>
+#include <array>
+#include <list>
+#include <mutex>
+#include <string>
+#include <utility>
 #include "IKP.hpp"
 
 #ifdef _WIN32
@@ -17,10 +23,57 @@
 #endif
 
 namespace SubIT {
-    SbIKPByteDecoder::SbIKPByteDecoder(const uint8_t *freqs, const uint8_t totalCount) {
+    static inline bool ReadBit(uint8_t** data, uint8_t* bitPos) {
+        const bool bit = **data & *bitPos;
+        *bitPos >>= 1;
+        if (!*bitPos) { *bitPos = 0x80; ++*data; }
+        return bit;
+    }
+
+    // Same walk as the emitted code: 0 is zero, otherwise a 1 for every chunk passed and the mark inside the chunk.
+    template <size_t totalCount, size_t... chunks>
+    static uint8_t StaticDecode(const uint8_t* freqs, uint8_t** data, uint8_t* bitPos, std::index_sequence<chunks...>) {
+        if (!ReadBit(data, bitPos)) { return 0; }
+        uint8_t value = 0;
+        if ((... || (!ReadBit(data, bitPos) && ((value = freqs[(chunks << 1) + ReadBit(data, bitPos)]), true)))) { return value; }
+        if constexpr (totalCount & 1) { return freqs[totalCount - 1]; }
+        else                          { return freqs[totalCount - 2 + ReadBit(data, bitPos)]; }
+    }
+
+    template <size_t totalCount>
+    static uint8_t StaticDecode(const uint8_t* freqs, uint8_t, uint8_t** data, uint8_t* bitPos) {
+        if constexpr (totalCount == 0) { return 0; }
+        else { return StaticDecode<totalCount>(freqs, data, bitPos, std::make_index_sequence<((totalCount - 1) >> 1)>()); }
+    }
+
+    // Bigger tables, the same walk with a loop.
+    static uint8_t StaticDecodeAny(const uint8_t* freqs, uint8_t totalCount, uint8_t** data, uint8_t* bitPos) {
+        if (!ReadBit(data, bitPos)) { return 0; }
+        const size_t fullChunks = (totalCount - 1) >> 1;
+        for (size_t chunk = 0; chunk != fullChunks; ++chunk) {
+            if (!ReadBit(data, bitPos)) { return freqs[(chunk << 1) + ReadBit(data, bitPos)]; }
+        }
+        return (totalCount & 1) ? freqs[totalCount - 1] : freqs[totalCount - 2 + ReadBit(data, bitPos)];
+    }
+
+    template <size_t... sizes>
+    static constexpr std::array<SbIKPByteDecoder::staticFn, sizeof...(sizes)> MakeStaticDecoders(std::index_sequence<sizes...>) {
+        return { &StaticDecode<sizes>... };
+    }
+    static constexpr auto sStaticDecoders = MakeStaticDecoders(std::make_index_sequence<SbIKPByteDecoder::staticUnrolled + 1>());
+
+    SbIKPByteDecoder::SbIKPByteDecoder(const uint8_t *f, const uint8_t totalCount, bool jit) : totalCount(totalCount) {
+        std::memcpy(freqs, f, totalCount);
+        staticFun = (totalCount <= staticUnrolled) ? sStaticDecoders[totalCount] : &StaticDecodeAny;
+        if (!jit || totalCount == 0) { return; }
+#if SB_IKP_JIT
+        const uint8_t* const freqs = f;
+        // Header, one block per full chunk, the last chunk and the returning block.
+        const int64_t codeSize = 0x31 + ((totalCount - 1) >> 1) * 0x58 + ((totalCount & 1) ? 5 : 0x2e);
         int moffset = 0;
 #ifdef _WIN32
-        char *nmem = (char *)VirtualAlloc(nullptr, funsiz = (17+0x31+((int)((totalCount - 3)>>1)*0x58)+((totalCount&1) ? 5 : 0x2e)+0x2e), MEM_COMMIT, PAGE_READWRITE);
+        char *nmem = (char *)VirtualAlloc(nullptr, funsiz = 17 + codeSize + 0x31, MEM_COMMIT, PAGE_READWRITE);
+        if (nmem == nullptr) { funsiz = 0; return; }
         const uint8_t win_workaround[17] = {0x57, 0x56,
                                                  0x41, 0x54,
                                                  0x41, 0x55,
@@ -32,7 +85,8 @@ namespace SubIT {
         moffset = 17;
         const uint64_t returnAddr = 0x31+((int)((totalCount - 1)>>1)*0x58)+((totalCount&1) ? 5 : 0x2e);
 #else
-        char *nmem = (char *)mmap(NULL, funsiz = (0x31+((int)((totalCount - 3)>>1)*0x58)+((totalCount&1) ? 5 : 0x2e)+0x23), PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        char *nmem = (char *)mmap(NULL, funsiz = codeSize + 0x26, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (nmem == MAP_FAILED) { funsiz = 0; return; }
         const uint64_t returnAddr = 0x31+((int)((totalCount - 1)>>1)*0x58)+((totalCount&1) ? 5 : 0x2e);
 #endif
         {
@@ -171,18 +225,42 @@ namespace SubIT {
         memcpy(nmem+moffset, returning, 0x26);
         funsiz = moffset+0x26;
 #endif
+        // Writing is over, only now the pages become executable. Stay with the static decoder if that's refused.
 #ifdef _WIN32
         DWORD tmp;
-        VirtualProtect(nmem, funsiz, PAGE_EXECUTE_READ, &tmp);
+        if (!VirtualProtect(nmem, funsiz, PAGE_EXECUTE_READ, &tmp)) { VirtualFree(nmem, 0, MEM_RELEASE); funsiz = 0; return; }
+        FlushInstructionCache(GetCurrentProcess(), nmem, funsiz);
+#else
+        if (mprotect(nmem, funsiz, PROT_READ | PROT_EXEC) != 0) { munmap(nmem, funsiz); funsiz = 0; return; }
 #endif
         decoderFun = (fn)nmem;
-        return;
+#endif
     }
     SbIKPByteDecoder::~SbIKPByteDecoder() {
+        if (decoderFun == nullptr) { return; }
 #ifdef _WIN32
         VirtualFree((void*)decoderFun, 0, MEM_RELEASE);
 #else
         munmap((void *)decoderFun, funsiz);
 #endif
     }
+
+    std::shared_ptr<const SbIKPByteDecoder> SbIKPByteDecoder::Acquire(const uint8_t *f, const uint8_t totalCount, bool jit) {
+        static std::mutex mutex;
+        // Most recently used first, a handful of entries so a linear search is fine.
+        static std::list<std::pair<std::string, std::shared_ptr<const SbIKPByteDecoder>>> recent;
+        std::string key(reinterpret_cast<const char*>(f), totalCount);
+        key.push_back(static_cast<char>(jit));
+
+        std::lock_guard lock(mutex);
+        const auto it = std::find_if(recent.begin(), recent.end(), [&key](const auto& entry) { return entry.first == key; });
+        if (it != recent.end()) {
+            recent.splice(recent.begin(), recent, it);
+            return recent.front().second;
+        }
+        auto decoder = std::make_shared<const SbIKPByteDecoder>(f, totalCount, jit);
+        recent.emplace_front(std::move(key), decoder);
+        if (recent.size() > cacheCapacity) { recent.pop_back(); }
+        return decoder;
+    }
 }
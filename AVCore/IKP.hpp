@@ -8,21 +8,46 @@
 #pragma once
 
 #include <cstdint>
+#include <cstddef>
+#include <memory>
+
+// Runtime code generation is x86-64 only, other platforms and SB_IKP_NO_JIT builds use the static decoders.
+#if !defined(SB_IKP_NO_JIT) && (defined(__x86_64__) || defined(_M_X64))
+#define SB_IKP_JIT 1
+#else
+#define SB_IKP_JIT 0
+#endif
 
 namespace SubIT {
 
     // IKP accelerated byte decoder by Steve Wang.
+    // Code is written into RW pages which become RX before the first call, no page is ever writable and executable.
+    // Without JIT (not allowed, not x86-64 or mapping failed) it walks the same code with a template decoder,
+    // unrolled for tables up to staticUnrolled values.
     class SbIKPByteDecoder {
     public:
-        using fn = uint8_t(*)(uint8_t**, uint8_t*);
-        
-        fn        decoderFun;
-        int64_t   funsiz;
-        
-        SbIKPByteDecoder(const uint8_t *freqs, const uint8_t totalCount);
+        using fn       = uint8_t(*)(uint8_t**, uint8_t*);
+        using staticFn = uint8_t(*)(const uint8_t*, uint8_t, uint8_t**, uint8_t*);
+        static constexpr uint8_t staticUnrolled = 64;
+        static constexpr size_t  cacheCapacity  = 64;
+
+        fn        decoderFun = nullptr;
+        int64_t   funsiz     = 0;
+
+        SbIKPByteDecoder(const uint8_t *freqs, const uint8_t totalCount, bool jit = SB_IKP_JIT);
         ~SbIKPByteDecoder();
-        
-        inline uint8_t operator()(uint8_t **data, uint8_t *bitPos) const { return decoderFun(data, bitPos); }
+        SbIKPByteDecoder(const SbIKPByteDecoder&) = delete;
+        SbIKPByteDecoder& operator=(const SbIKPByteDecoder&) = delete;
+
+        inline uint8_t operator()(uint8_t **data, uint8_t *bitPos) const { return decoderFun ? decoderFun(data, bitPos) : staticFun(freqs, totalCount, data, bitPos); }
+
+        // Process-wide cache keyed by the table, keeps the last cacheCapacity decoders alive. Thread safe.
+        static std::shared_ptr<const SbIKPByteDecoder> Acquire(const uint8_t *freqs, const uint8_t totalCount, bool jit = SB_IKP_JIT);
+
+    private:
+        staticFn  staticFun  = nullptr;
+        uint8_t   totalCount = 0;
+        uint8_t   freqs[256] = {};
     };
-    
-}
\ No newline at end of file
+
+}
@@ -0,0 +1,174 @@
+///
+/// \file      LUT.cpp
+/// \brief     Table driven MaxFOG byte decoder.
+/// \author    HenryDu
+/// \date      10.16.2026
+/// \copyright © HenryDu 2026. All right reserved.
+///
+
+#include "LUT.hpp"
+#include "MaxFOG.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#ifdef _MSC_VER
+#include <stdlib.h> // for _byteswap_uint64
+#endif
+
+namespace SubIT {
+
+    static inline uint64_t LoadBigEndian64(const uint8_t* p) {
+        uint64_t v;
+        std::memcpy(&v, p, sizeof(v));
+#ifdef _MSC_VER
+        return _byteswap_uint64(v);
+#else
+        return __builtin_bswap64(v);
+#endif
+    }
+
+    // Walk one Golomb code bit by bit, the same way IKP does.
+    // Returns 0 for the zero symbol, rank + 1 for tree values and -1 when getBit runs out of bits.
+    template <typename GetBit>
+    static int WalkCode(size_t totalCount, GetBit&& getBit) {
+        int bit = getBit();
+        if (bit <= 0) { return bit; }
+        const size_t fullChunks = totalCount ? (totalCount - 1) >> 1 : 0;
+        for (size_t chunk = 0; chunk != fullChunks; ++chunk) {
+            if ((bit = getBit()) < 0) { return -1; }
+            if (bit) { continue; } // Not in this chunk.
+            if ((bit = getBit()) < 0) { return -1; }
+            return static_cast<int>((chunk << 1) + bit) + 1;
+        }
+        // Last chunk only needs a mark if it has two values.
+        if (totalCount - (fullChunks << 1) == 2) {
+            if ((bit = getBit()) < 0) { return -1; }
+            return static_cast<int>((fullChunks << 1) + bit) + 1;
+        }
+        return static_cast<int>(fullChunks << 1) + 1;
+    }
+
+    SbLUTByteDecoder::SbLUTByteDecoder(const uint8_t *f, const uint8_t n, bool runs) : SbLUTByteDecoder(&f, &n, 1, runs) {}
+
+    SbLUTByteDecoder::SbLUTByteDecoder(const uint8_t* const* f, const uint8_t* n, size_t count, bool runs) : trees(), treeCount(count), zeroRuns(runs) {
+        for (size_t t = 0; t != treeCount; ++t) {
+            Tree& tree = trees[t];
+            tree.totalCount = n[t];
+            std::memcpy(tree.freqs, f[t], n[t]);
+            // Entry layout: symbols in bytes [0,6), symbol count in byte 6, bits used in byte 7.
+            for (size_t index = 0; index != (size_t(1) << lookupBits); ++index) {
+                uint64_t symbols = 0;
+                size_t   used = 0, count = 0;
+                while (count != 6) {
+                    size_t pos = used;
+                    const int code = WalkCode(tree.totalCount, [&] {
+                        return (pos == lookupBits) ? -1 : static_cast<int>((index >> (lookupBits - 1 - pos++)) & 1);
+                    });
+                    if (code < 0) { break; }
+                    const uint8_t value = code ? tree.freqs[code - 1] : 0;
+                    if (zeroRuns && code && !value) { break; } // Run marker, run code is left to the slow path.
+                    symbols |= static_cast<uint64_t>(value) << (count << 3);
+                    ++count;
+                    used = pos;
+                    if (count == 1) { tree.firstBits[index] = static_cast<uint8_t>(used); }
+                }
+                tree.table[index] = symbols | (static_cast<uint64_t>(count) << 48) | (static_cast<uint64_t>(used) << 56);
+            }
+        }
+    }
+
+    size_t SbLUTByteDecoder::operator()(uint8_t* beg, const uint8_t* data, size_t bits, const std::function<void(size_t)>& progress) const {
+        return (treeCount == 1) ? Decode<false>(beg, data, bits, progress) : Decode<true>(beg, data, bits, progress);
+    }
+
+    template <bool banded>
+    size_t SbLUTByteDecoder::Decode(uint8_t* beg, const uint8_t* data, size_t bits, const std::function<void(size_t)>& progress) const {
+        uint8_t* const  start   = beg;
+        const size_t    bytes   = (bits + 7) >> 3;
+        const uint8_t*  src     = data; // Bits are read from data, then from a copy of its tail.
+        size_t          skipped = 0;    // Bits before src.
+        const uint8_t*  next    = data;
+        uint64_t        buf     = 0;
+        unsigned        count   = 0;
+        // Branch free refill, buf always has 56 to 63 valid bits after it, next is where the following bits start.
+        const auto refill   = [&] {
+            buf   |= LoadBigEndian64(next) >> count;
+            next  += (63 - count) >> 3;
+            count |= 56;
+        };
+        const auto consume  = [&](unsigned n) { buf <<= n; count -= n; };
+        const auto position = [&] { return skipped + (static_cast<size_t>(next - src) << 3) - count; };
+        const auto getBit   = [&] {
+            refill();
+            const int bit = static_cast<int>(buf >> 63);
+            consume(1);
+            return bit;
+        };
+        const auto treeAt   = [&]() -> const Tree& {
+            return trees[banded ? SbCodecMaxFOG::Band(static_cast<size_t>(beg - start)) : 0];
+        };
+        // Long codes and zero run markers, one symbol at a time.
+        const auto slow = [&] {
+            const Tree&   tree  = treeAt();
+            const int     code  = WalkCode(tree.totalCount, getBit);
+            const uint8_t value = code ? tree.freqs[code - 1] : 0;
+            if (!zeroRuns || !code || value) { *beg++ = value; return; }
+            size_t run = SbCodecMaxFOG::runSegment - (static_cast<size_t>(beg - start) & (SbCodecMaxFOG::runSegment - 1));
+            if (getBit()) {
+                int width = 1;
+                while (!getBit()) { ++width; }
+                size_t v = 1;
+                for (int i = 1; i != width; ++i) { v = (v << 1) | static_cast<size_t>(getBit()); }
+                run = v + 1;
+            }
+            std::memset(beg, 0, run);
+            beg += run;
+        };
+
+        // Next count of written bytes progress hears about.
+        size_t     mark     = progress ? SbCodecMaxFOG::progressStep : SIZE_MAX;
+        const auto report   = [&] {
+            const size_t written = static_cast<size_t>(beg - start);
+            progress(written);
+            mark = (written / SbCodecMaxFOG::progressStep + 1) * SbCodecMaxFOG::progressStep;
+        };
+
+        // Every lookup stays inside the limit, the last few codes go through the slow path.
+        const auto lookups = [&](size_t limit) {
+            while (position() + lookupBits <= limit) {
+                if (static_cast<size_t>(beg - start) >= mark) [[unlikely]] { report(); }
+                refill();
+                const Tree&    tree  = treeAt();
+                const size_t   index = static_cast<size_t>(buf >> (64 - lookupBits));
+                const uint64_t entry = tree.table[index];
+                size_t         n     = (entry >> 48) & 0xFF;
+                unsigned       used  = static_cast<unsigned>(entry >> 56);
+                if (!n) { slow(); continue; }
+                if constexpr (banded) {
+                    // Symbols after the band belong to another tree, take only the first one then.
+                    const size_t pos = static_cast<size_t>(beg - start);
+                    if (n > SbCodecMaxFOG::BandEnd(pos) - (pos & (SbCodecMaxFOG::runSegment - 1))) { n = 1; used = tree.firstBits[index]; }
+                }
+                for (size_t i = 0; i != n; ++i) { beg[i] = static_cast<uint8_t>(entry >> (i << 3)); }
+                beg += n;
+                consume(used);
+            }
+        };
+
+        // Refills load 8 bytes and one slow symbol takes less than 160 bits, so lookups stop 64 bytes before
+        // the end of data. The rest is decoded from a zero padded copy and nothing after data is ever read.
+        constexpr size_t tailBytes = 64;
+        lookups(bytes > tailBytes ? std::min(bits, (bytes - tailBytes) << 3) : 0);
+        const size_t at = position();
+        uint8_t      tail[tailBytes * 2] = {};
+        std::memcpy(tail, data + (at >> 3), bytes - std::min(bytes, at >> 3));
+        src = next = tail, skipped = at & ~size_t(7), buf = 0, count = 0;
+        refill();
+        consume(static_cast<unsigned>(at & 7));
+        lookups(bits);
+        while (position() < bits) { slow(); }
+        return static_cast<size_t>(beg - start);
+    }
+
+}
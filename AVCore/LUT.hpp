@@ -0,0 +1,49 @@
+///
+/// \file      LUT.hpp
+/// \brief     Table driven MaxFOG byte decoder.
+/// \details   Portable counterpart of the IKP byte decoder, decodes the same stream.
+/// \author    HenryDu
+/// \date      10.16.2026
+/// \copyright © HenryDu 2026. All right reserved.
+///
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+
+namespace SubIT {
+
+    // Keeps 56 to 63 bits of the stream inside a 64 bit register and looks up several short codes at once.
+    // Every table entry holds up to 6 symbols, how many of them and how many bits they took.
+    // Codes longer than the lookup (or zero run markers) fall back to walking the tree bit by bit.
+    // With several trees (MaxFOG band mode) every band has its own table, lookups don't cross a band.
+    class SbLUTByteDecoder {
+    public:
+        static constexpr size_t lookupBits = 11;
+        static constexpr size_t maxTrees   = 3;
+
+        SbLUTByteDecoder(const uint8_t *freqs, const uint8_t totalCount, bool zeroRuns);
+        SbLUTByteDecoder(const uint8_t* const* freqs, const uint8_t* totalCounts, size_t treeCount, bool zeroRuns);
+
+        // Decode symbols till bits of data are consumed and return how many bytes are written.
+        // Nothing after the last encoded byte is read, so data can end right there (a file mapping for example).
+        // progress is told about written bytes as SbCodecMaxFOG::DecodeBits describes.
+        size_t operator()(uint8_t* beg, const uint8_t* data, size_t bits, const std::function<void(size_t)>& progress = nullptr) const;
+
+    private:
+        struct Tree {
+            uint64_t  table[size_t(1) << lookupBits];
+            uint8_t   firstBits[size_t(1) << lookupBits]; // Bits of the first symbol, for lookups cut at a band.
+            uint8_t   freqs[256];
+            uint8_t   totalCount;
+        };
+        template <bool banded>
+        size_t Decode(uint8_t* beg, const uint8_t* data, size_t bits, const std::function<void(size_t)>& progress) const;
+
+        Tree      trees[maxTrees];
+        size_t    treeCount;
+        bool      zeroRuns;
+    };
+
+}
@@ -10,15 +10,37 @@
 #include <ios>
 #include <ostream>
 #include <istream>
+#include <bit> // for std::countl_zero and std::bit_width
 
 #include "MaxFOG.hpp"
 #include "IKP.hpp"
+#include "LUT.hpp"
+#include "MemoryStream.hpp"
+#include "ThreadPool.hpp"
 
 #include <iostream>
 #include <cstddef>
 #include <cstring>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <optional>
+#include <atomic>
+#include <stdexcept>
 
 namespace SubIT {
+    // Sort all values with non-zero counts by count, most frequent one comes first.
+    static uint8_t* MakeTreeFromCounts(uint8_t* treeBeg, const size_t (&countMap)[256], bool withZero) {
+        uint8_t *treeEnd = treeBeg;
+        for (size_t i = withZero ? 0 : 1; i != 256; ++i) {
+            if (countMap[i] != 0) { *treeEnd++ = static_cast<uint8_t>(i); }
+        }
+        std::stable_sort(treeBeg, treeEnd, [&countMap](auto a, auto b) {
+            return countMap[a] > countMap[b];
+        });
+        return treeEnd;
+    }
+
     uint8_t* SbCodecMaxFOG::MakeTree(uint8_t* treeBeg, uint8_t* beg, uint8_t* end) {
         size_t  countMap[256] = {};
         uint8_t *treeEnd = treeBeg;
@@ -36,77 +58,318 @@ namespace SubIT {
         return treeEnd;
     }
 
-    size_t SbCodecMaxFOG::EncodeBytes(uint8_t* beg, uint8_t* end, std::ostream* stream, uint8_t* buff) {
-        // For future relocate.
-        const std::streampos streambeg = stream->tellp();
-
-        // Leave this part empty to fill how many bits encoded after encode.
-        stream->seekp(sizeof(size_t), std::ios_base::cur);
-
-        // Create tree.
-        uint8_t  treeBeg[256];
-        uint8_t* treeEnd = MakeTree(treeBeg, beg, end);
-
-        // Write tree to stream for further decode.
-        const size_t nodeCount = static_cast<size_t>(treeEnd - treeBeg);
-        stream->rdbuf()->sputc(static_cast<char>(nodeCount & 0xFF));
-        for (uint8_t i = 0; i != nodeCount; ++i) {
-            stream->rdbuf()->sputc(static_cast<char>(treeBeg[i]));
-        }
-
-        // Create acMap and fill it to accelerate the encode process.
-        uint8_t  acMap[256] = {};
-        for (uint8_t i = 0; i != nodeCount; ++i) {
-            acMap[treeBeg[i]] = i;
-        }
-
-        uint8_t obuf = 0, bufPos = 0x80;
-#define PUT_BIT(x) if(x) obuf |= bufPos;\
-            bufPos >>= 1;\
-            if(!bufPos) {\
-                stream->rdbuf()->sputc(static_cast<char>(obuf));\
-                obuf = 0, bufPos = 0x80;\
-            }
-        // Write all bytes into bit stream according to the map.
-        size_t     bitsEncoded = 0;
-        for(; beg != end; ++beg) {
-            if(*beg == '\0') { // 0 is treated differently because of the nature of DCT'ed data, especially after quantization.
-                PUT_BIT(0)
-                ++bitsEncoded;
-                continue;
-            }
-            PUT_BIT(1); // Golomb coding
-            ++bitsEncoded;
-            auto treePos = treeBeg;
-            for(; treeEnd - treePos > 2; treePos += 2) {
-                if(*treePos == *beg) { // No.0 in current chunk
-                    PUT_BIT(0)
-                    PUT_BIT(0)
-                    bitsEncoded += 2;
+    // MSB first bit writer, bits are collected in a 64 bit accumulator and stored 32 at a time into memory.
+    // Memory only goes to the stream when it's full or at the end, so most inputs are written in one go.
+    // Chunked buffers write every spill as a chunk (u64 bits, then bytes) and end with an empty one.
+    class SbBitBuffer {
+    public:
+        SbBitBuffer(uint8_t* beg, size_t size, std::ostream* stream, bool chunked = false)
+        : beg(beg), chunked(chunked), cur(beg), limit(beg + size - 8), stream(stream) {}
+
+        // n is not greater than 32.
+        void Put(uint64_t code, size_t n) {
+            acc    = (acc << n) | code;
+            bits  += n;
+            total += n;
+            if (bits >= 32) {
+                bits -= 32;
+                StoreWord(static_cast<uint32_t>(acc >> bits));
+                cur += 4;
+                if (cur > limit) { Spill(); }
+            }
+        }
+        void PutZeros(size_t n) {
+            for (; n > 32; n -= 32) { Put(0, 32); }
+            Put(0, n);
+        }
+        void PutOnes(size_t n) {
+            for (; n > 32; n -= 32) { Put(0xFFFFFFFF, 32); }
+            Put((uint64_t(1) << n) - 1, n);
+        }
+        // Raw bytes, only used before any bit is put. They go straight to the stream when chunked.
+        void PutBytes(const void* src, size_t n) {
+            if (chunked) {
+                stream->write(static_cast<const char*>(src), static_cast<std::streamsize>(n));
+                return;
+            }
+            std::memcpy(cur, src, n);
+            cur += n;
+        }
+        // Pad the last byte with zeros and write everything left to the stream.
+        void Finish() {
+            if (bits != 0) {
+                StoreWord(static_cast<uint32_t>(acc << (32 - bits)));
+                cur += (bits + 7) >> 3;
+            }
+            if (!chunked) {
+                Spill();
+                return;
+            }
+            // Last chunk is the only one which may end inside a byte.
+            if (cur != beg) { Spill(total - chunkedBits); }
+            const uint64_t end = 0;
+            stream->write(reinterpret_cast<const char*>(&end), sizeof(end));
+        }
+
+        uint8_t* const beg;
+        const bool     chunked;
+        std::streampos streambeg;        // Where beg went inside the stream, valid once spilled.
+        size_t         total   = 0;      // Bits put.
+        bool           spilled = false;
+
+    private:
+        void StoreWord(uint32_t word) {
+            cur[0] = static_cast<uint8_t>(word >> 24); cur[1] = static_cast<uint8_t>(word >> 16);
+            cur[2] = static_cast<uint8_t>(word >> 8);  cur[3] = static_cast<uint8_t>(word);
+        }
+        void Spill(uint64_t chunkBits = 0) {
+            if (chunked) {
+                chunkBits    = chunkBits ? chunkBits : static_cast<uint64_t>(cur - beg) << 3;
+                chunkedBits += chunkBits;
+                stream->write(reinterpret_cast<const char*>(&chunkBits), sizeof(chunkBits));
+            }
+            else if (!spilled) { streambeg = stream->tellp(); }
+            stream->write(reinterpret_cast<const char*>(beg), cur - beg);
+            cur     = beg;
+            spilled = true;
+        }
+
+        uint8_t*        cur;
+        uint8_t* const  limit;
+        std::ostream*   stream;
+        uint64_t        acc  = 0;
+        size_t          bits = 0;
+        size_t          chunkedBits = 0; // Bits inside the chunks written so far.
+    };
+
+    // Golomb code of a tree value: ones (prefix included) till its chunk, then the mark inside the chunk.
+    struct SbCodeword {
+        uint32_t code;       // Whole code if length is not greater than 32.
+        uint8_t  length;
+        uint8_t  ones;
+        uint8_t  tail;
+        uint8_t  tailLength;
+    };
+
+    static void MakeCodewords(SbCodeword (&codewords)[256], const uint8_t* treeBeg, size_t nodeCount) {
+        const size_t fullChunks = nodeCount ? (nodeCount - 1) >> 1 : 0;
+        for (size_t rank = 0; rank != nodeCount; ++rank) {
+            SbCodeword& cw = codewords[treeBeg[rank]];
+            const size_t chunk = rank >> 1;
+            cw.ones       = static_cast<uint8_t>(1 + chunk);
+            cw.tailLength = (chunk < fullChunks) ? 2 : ((nodeCount - (fullChunks << 1) == 2) ? 1 : 0);
+            cw.tail       = cw.tailLength ? static_cast<uint8_t>(rank & 1) : 0; // Full chunks put a 0 before the mark.
+            cw.length     = static_cast<uint8_t>(std::min<size_t>(255, cw.ones + cw.tailLength));
+            cw.code       = (cw.ones + cw.tailLength <= 32) ? static_cast<uint32_t>((((uint64_t(1) << cw.ones) - 1) << cw.tailLength) | cw.tail) : 0;
+        }
+    }
+
+    static inline void PutCodeword(SbBitBuffer& bb, const SbCodeword& cw) {
+        if (cw.ones + cw.tailLength <= 32) { bb.Put(cw.code, cw.ones + cw.tailLength); return; }
+        bb.PutOnes(cw.ones);
+        bb.Put(cw.tail, cw.tailLength);
+    }
+
+    static size_t ExpGolombLength(size_t v) {
+        return (static_cast<size_t>(std::bit_width(v + 1)) << 1) - 1;
+    }
+
+    enum SbZeroRunToken { TokenSymbol, TokenZeros, TokenRun, TokenEndOfBlock };
+
+    // Split bytes into run mode tokens, a zero run becomes one run (or end of block) token only when it is
+    // cheaper than coding every zero by one bit, otherwise they're plain zeros. Runs never cross a segment boundary.
+    // markerBits(offset) is the code length of the run marker for a run starting at offset, fn gets the offset too.
+    template <typename MarkerBits, typename Fn>
+    static void ForEachZeroRunToken(const uint8_t* beg, const uint8_t* end, MarkerBits&& markerBits, Fn&& fn) {
+        const uint8_t* const start = beg;
+        while (beg != end) {
+            const size_t offset = static_cast<size_t>(beg - start);
+            if (*beg != 0) { fn(TokenSymbol, *beg++, offset); continue; }
+            const uint8_t* segmentEnd = start + std::min(static_cast<size_t>(end - start), (offset | (SbCodecMaxFOG::runSegment - 1)) + 1);
+            const uint8_t* runEnd     = std::find_if(beg, segmentEnd, [](uint8_t v) { return v != 0; });
+            const size_t   run        = static_cast<size_t>(runEnd - beg);
+            const size_t   marker     = markerBits(offset);
+            // A short last segment can't end with end of block, decoder would fill the whole segment.
+            const bool     fullSegment = !(static_cast<size_t>(segmentEnd - start) & (SbCodecMaxFOG::runSegment - 1));
+            if (runEnd == segmentEnd && fullSegment && marker + 1 < run) { fn(TokenEndOfBlock, run, offset); }
+            else if (run >= 2 && marker + 1 + ExpGolombLength(run - 2) < run) { fn(TokenRun, run, offset); }
+            else { fn(TokenZeros, run, offset); }
+            beg = runEnd;
+        }
+    }
+
+    // Trees of a stream and their codewords, one for every band in band mode and a single one otherwise.
+    struct SbTreeSet {
+        uint8_t    trees[SbCodecMaxFOG::bandCount][256];
+        uint8_t    nodeCounts[SbCodecMaxFOG::bandCount];
+        SbCodeword codewords[SbCodecMaxFOG::bandCount][256];
+        size_t     markerBits[SbCodecMaxFOG::bandCount];
+        size_t     count;
+    };
+
+    // Put symbols of [beg, end) with the codewords, run tokens never cross runSegment so any segment can go alone.
+    template <bool banded>
+    static void PutSymbols(SbBitBuffer& bb, const uint8_t* beg, const uint8_t* end, const SbTreeSet& set, bool zeroRuns) {
+        const auto tree = [](size_t offset) { return banded ? SbCodecMaxFOG::Band(offset) : 0; };
+        if (zeroRuns) {
+            ForEachZeroRunToken(beg, end, [&](size_t offset) { return set.markerBits[tree(offset)]; }, [&](SbZeroRunToken token, size_t v, size_t offset) {
+                const SbCodeword* codewords = set.codewords[tree(offset)];
+                switch (token) {
+                case TokenSymbol: PutCodeword(bb, codewords[v]); break;
+                case TokenZeros:  bb.PutZeros(v); break;
+                case TokenEndOfBlock:
+                    PutCodeword(bb, codewords[0]);
+                    bb.Put(0, 1);
                     break;
-                }
-                if(*(treePos+1) == *beg) { // No.1 in current chunk
-                    PUT_BIT(0)
-                    PUT_BIT(1)
-                    bitsEncoded += 2;
+                case TokenRun: {
+                    // Run flag, then exponential Golomb code of run - 2, leading zeros tell how many bits follow the first 1.
+                    const size_t value = v - 1;
+                    const size_t width = static_cast<size_t>(std::bit_width(value));
+                    PutCodeword(bb, codewords[0]);
+                    bb.Put(1, 1);
+                    bb.PutZeros(width - 1);
+                    bb.Put(value, width);
                     break;
                 }
-                PUT_BIT(1)  // Otherwise, go to the next chunk
-                ++bitsEncoded;
+                }
+            });
+            return;
+        }
+        const uint8_t* const start = beg;
+        while (beg != end) {
+            if (*beg != '\0') { PutCodeword(bb, set.codewords[tree(static_cast<size_t>(beg - start))][*beg]); ++beg; continue; }
+            // 0 is treated differently because of the nature of DCT'ed data, especially after quantization.
+            const uint8_t* runEnd = std::find_if(beg, end, [](uint8_t v) { return v != 0; });
+            bb.PutZeros(static_cast<size_t>(runEnd - beg));
+            beg = runEnd;
+        }
+    }
+
+    static void PutSymbols(SbBitBuffer& bb, const uint8_t* beg, const uint8_t* end, const SbTreeSet& set, bool zeroRuns) {
+        if (set.count == 1) { PutSymbols<false>(bb, beg, end, set, zeroRuns); }
+        else                { PutSymbols<true> (bb, beg, end, set, zeroRuns); }
+    }
+
+    // Split [0, count) into a few contiguous ranges per thread of the current pool and run fn(first, last) on each of them.
+    template <typename Fn>
+    static void ParallelRanges(size_t count, Fn&& fn) {
+        SbThreadPool& pool   = SbThreadPool::Current();
+        const size_t  ranges = std::min<size_t>(count, 4 * (pool.Size() + 1));
+        pool.ParallelFor(ranges, [&](size_t r) { fn(count * r / ranges, count * (r + 1) / ranges); });
+    }
+
+    size_t SbCodecMaxFOG::EncodeBytes(uint8_t* beg, uint8_t* end, std::ostream* stream, uint8_t* buff, size_t buffSize, uint32_t modes, size_t restartSymbols) {
+        const bool zeroRuns = modes & ModeZeroRun;
+        const bool banded   = modes & ModeBands;
+
+        // Create trees.
+        SbTreeSet set;
+        set.count = banded ? bandCount : 1;
+        const auto tree = [banded](size_t offset) { return banded ? Band(offset) : 0; };
+        if (zeroRuns || banded) {
+            // Value 0 joins the tree as run marker in run mode, guess its code length to count runs.
+            size_t countMaps[bandCount][256] = {};
+            if (zeroRuns) {
+                ForEachZeroRunToken(beg, end, [](size_t) { return size_t(4); }, [&](SbZeroRunToken token, size_t v, size_t offset) {
+                    if (token == TokenSymbol)                             { ++countMaps[tree(offset)][v]; }
+                    if (token == TokenRun || token == TokenEndOfBlock)    { ++countMaps[tree(offset)][0]; }
+                });
+            }
+            else {
+                for (const uint8_t* cur = beg; cur != end; ++cur) { ++countMaps[tree(static_cast<size_t>(cur - beg))][*cur]; }
+                for (auto& countMap : countMaps) { countMap[0] = 0; }
+            }
+            for (size_t t = 0; t != set.count; ++t) {
+                // Tree size is one byte, when every other value is used there is no room for the marker.
+                auto& countMap = countMaps[t];
+                if (std::count_if(countMap + 1, countMap + 256, [](size_t c) { return c != 0; }) == 255) { countMap[0] = 0; }
+                set.nodeCounts[t] = static_cast<uint8_t>((MakeTreeFromCounts(set.trees[t], countMap, true) - set.trees[t]) & 0xFF);
+            }
+        }
+        else {
+            set.nodeCounts[0] = static_cast<uint8_t>((MakeTree(set.trees[0], beg, end) - set.trees[0]) & 0xFF);
+        }
+        for (size_t t = 0; t != set.count; ++t) {
+            const uint8_t* treeBeg = set.trees[t];
+            const uint8_t* treeEnd = treeBeg + set.nodeCounts[t];
+            MakeCodewords(set.codewords[t], treeBeg, set.nodeCounts[t]);
+            // Without any run it's a plain stream with a useless flag, bits never tell them apart.
+            set.markerBits[t] = (std::find(treeBeg, treeEnd, 0) != treeEnd) ? set.codewords[t][0].length : SIZE_MAX >> 1;
+        }
+
+        if (modes & ModeRestart) {
+            // Every segment is coded by itself and starts at a byte, they only share the trees.
+            const size_t segmentSymbols = std::max(runSegment, ((restartSymbols ? restartSymbols : defaultRestartSymbols) + runSegment - 1) & ~(runSegment - 1));
+            const size_t count          = (static_cast<size_t>(end - beg) + segmentSymbols - 1) / segmentSymbols;
+            std::vector<std::string> segments(count);
+            std::vector<uint64_t>    segmentBits(count);
+            ParallelRanges(count, [&](size_t first, size_t last) {
+                std::vector<uint8_t> local(size_t(1) << 16);
+                for (size_t i = first; i != last; ++i) {
+                    std::ostringstream segment(std::ios::binary);
+                    SbBitBuffer bb(local.data(), local.size(), &segment);
+                    PutSymbols(bb, beg + i * segmentSymbols, std::min(end, beg + (i + 1) * segmentSymbols), set, zeroRuns);
+                    bb.Finish();
+                    segments[i]    = std::move(segment).str();
+                    segmentBits[i] = bb.total;
+                }
+            });
+            size_t payloadBytes = 0;
+            for (const auto& segment : segments) { payloadBytes += segment.size(); }
+            const size_t   bitsEncoded = payloadBytes << 3;
+            const uint32_t header[2]   = { static_cast<uint32_t>(segmentSymbols), static_cast<uint32_t>(count) };
+            stream->write(reinterpret_cast<const char*>(&bitsEncoded), sizeof(size_t));
+            for (size_t t = 0; t != set.count; ++t) {
+                stream->write(reinterpret_cast<const char*>(&set.nodeCounts[t]), 1);
+                stream->write(reinterpret_cast<const char*>(set.trees[t]), static_cast<std::streamsize>(set.nodeCounts[t]));
             }
-            if(treePos == treeEnd - 2) { // The last mark is only needed if there are two values in the last chunk
-                PUT_BIT(!(*treePos == *beg));
-                ++bitsEncoded;
+            stream->write(reinterpret_cast<const char*>(header), sizeof(header));
+            stream->write(reinterpret_cast<const char*>(segmentBits.data()), static_cast<std::streamsize>(count * sizeof(uint64_t)));
+            for (const auto& segment : segments) { stream->write(segment.data(), static_cast<std::streamsize>(segment.size())); }
+            stream->flush();
+            return bitsEncoded;
+        }
+
+        // Small buffers can't even hold the trees, use our own.
+        std::vector<uint8_t> ownBuffer;
+        if (buff == nullptr || buffSize < 1024) {
+            ownBuffer.resize(size_t(1) << 16);
+            buff = ownBuffer.data(), buffSize = ownBuffer.size();
+        }
+        SbBitBuffer bb(buff, buffSize, stream, modes & ModeChunked);
+
+        // Leave bits encoded empty to fill it after encode (chunks count them instead), then the trees for further decode.
+        const size_t placeholder = 0;
+        bb.PutBytes(&placeholder, sizeof(size_t));
+        for (size_t t = 0; t != set.count; ++t) {
+            bb.PutBytes(&set.nodeCounts[t], 1);
+            bb.PutBytes(set.trees[t], set.nodeCounts[t]);
+        }
+
+        // Write all bytes into bit stream according to the codewords.
+        PutSymbols(bb, beg, end, set, zeroRuns);
+
+        // Fill how many bits encoded, inside memory if nothing has gone yet, otherwise go back in the stream.
+        const size_t bitsEncoded = bb.total;
+        if (modes & ModeChunked) {
+            bb.Finish();
+        }
+        else if (!bb.spilled) {
+            std::memcpy(bb.beg, &bitsEncoded, sizeof(size_t));
+            bb.Finish();
+        }
+        else {
+            bb.Finish();
+            if (bb.streambeg == std::streampos(-1)) {
+                throw std::runtime_error("Error: maxfog stream can't seek back, use chunked mode.");
             }
+            const std::streampos streamend = stream->tellp();
+            stream->seekp(bb.streambeg);
+            stream->write(reinterpret_cast<const char*>(&bitsEncoded), sizeof(size_t));
+            stream->seekp(streamend);
         }
-        // Put remaining data (if exists).
-        if(bufPos != 0x80) stream->rdbuf()->sputc(obuf);
-        // Back to start position to write how many bits encoded.
-        stream->seekp(streambeg);
-        stream->write(reinterpret_cast<const char*>(&bitsEncoded), sizeof(size_t));
         stream->flush();
         return bitsEncoded;
-#undef PUT_BIT
     }
 
     size_t SbCodecMaxFOG::GetEncodedBits(std::istream* stream) {
@@ -115,24 +378,139 @@ namespace SubIT {
         return bits;
     }
 
-    size_t SbCodecMaxFOG::DecodeBits(uint8_t* beg, size_t bits, std::istream* stream, uint8_t* buf) {
-
-        // Get tree and its range.
-        uint8_t  treeBeg[256] = {};
-        uint8_t  nodeCount = 0;
-        stream->read(reinterpret_cast<char*>(&nodeCount), sizeof(uint8_t));
-        stream->read(reinterpret_cast<char*>(treeBeg), static_cast<std::streamsize>(nodeCount));
-
-        SbIKPByteDecoder bytDec(treeBeg, nodeCount);
-        uint8_t*         curByte    = reinterpret_cast<uint8_t*>(buf);
-        const size_t     totalBytes = (bits >> 3) + ((bits & 0x7) ? 1 : 0);
-        stream->read(reinterpret_cast<char*>(buf), totalBytes);
-        
-        size_t bytesDecoded = 0;
-        for(uint8_t bitPos = 0x80; (curByte - buf) < totalBytes || (0x80 >> (bits & 0x7)) >= bitPos; ++beg, ++bytesDecoded) {
-            *beg = bytDec(&curByte, &bitPos);
-        }
-        
-        return bytesDecoded;
+    // decoders holds one IKP decoder per band in band mode, a single one otherwise.
+    static size_t DecodeWithIKP(const std::shared_ptr<const SbIKPByteDecoder>* decoders, uint8_t* beg, const uint8_t* data, size_t bits, bool zeroRuns, bool banded,
+                                const SbCodecMaxFOG::Progress& progress) {
+        // IKP decoders only read through the pointer they advance.
+        uint8_t*       curByte = const_cast<uint8_t*>(data);
+        const uint8_t* src     = data; // Bits are read from data, then from a copy of its tail.
+        size_t         skipped = 0;    // Bits before src.
+
+        // JIT code loads 8 bytes at once and one symbol takes less than 160 bits, so the last 32 bytes are
+        // decoded from a zero padded copy and nothing after data is ever read.
+        constexpr size_t tailBytes = 32;
+        const size_t     bytes     = (bits + 7) >> 3;
+        uint8_t          tail[tailBytes * 2] = {};
+        const uint8_t*   tailFrom  = data + (bytes > tailBytes ? bytes - tailBytes : 0);
+
+        // Stop exactly at the last encoded bit, padding bits of the last byte are not symbols.
+        uint8_t* const start  = beg;
+        uint8_t        bitPos = 0x80;
+        const auto bitsConsumed = [&] { return skipped + (static_cast<size_t>(curByte - src) << 3) + static_cast<size_t>(std::countl_zero(bitPos)); };
+        const auto readBit = [&] {
+            const bool bit = *curByte & bitPos;
+            bitPos >>= 1;
+            if (!bitPos) { bitPos = 0x80; ++curByte; }
+            return bit;
+        };
+        size_t mark = progress ? SbCodecMaxFOG::progressStep : SIZE_MAX;
+        while (bitsConsumed() < bits) {
+            if (static_cast<size_t>(beg - start) >= mark) [[unlikely]] {
+                progress(static_cast<size_t>(beg - start));
+                mark = (static_cast<size_t>(beg - start) / SbCodecMaxFOG::progressStep + 1) * SbCodecMaxFOG::progressStep;
+            }
+            if (curByte >= tailFrom) [[unlikely]] {
+                const size_t at = static_cast<size_t>(curByte - data);
+                std::memcpy(tail, data + at, bytes - at);
+                src = curByte = tail, skipped = at << 3, tailFrom = tail + sizeof(tail);
+            }
+            // Zero symbol is a single 0 bit, don't bother the decoder for it.
+            if (!(*curByte & bitPos)) { readBit(); *beg++ = 0; continue; }
+            const uint8_t v = (*decoders[banded ? SbCodecMaxFOG::Band(static_cast<size_t>(beg - start)) : 0])(&curByte, &bitPos);
+            if (v != 0 || !zeroRuns) { *beg++ = v; continue; }
+            // Run marker, 0 for the end of block and 1 for a run of zeros.
+            size_t run = SbCodecMaxFOG::runSegment - (static_cast<size_t>(beg - start) & (SbCodecMaxFOG::runSegment - 1));
+            if (readBit()) {
+                int width = 1;
+                while (!readBit()) { ++width; }
+                size_t value = 1;
+                for (int i = 1; i != width; ++i) { value = (value << 1) | static_cast<size_t>(readBit()); }
+                run = value + 1;
+            }
+            std::memset(beg, 0, run);
+            beg += run;
+        }
+        return static_cast<size_t>(beg - start);
+    }
+
+    size_t SbCodecMaxFOG::DecodeBits(uint8_t* beg, size_t bits, std::istream* stream, uint8_t* buf, uint32_t modes, Decoder decoder, const Progress& progress) {
+        const bool   zeroRuns  = modes & ModeZeroRun;
+        const bool   banded    = modes & ModeBands;
+        const size_t treeCount = banded ? bandCount : 1;
+
+        // Get trees and their ranges.
+        uint8_t  trees[bandCount][256] = {};
+        uint8_t  nodeCounts[bandCount] = {};
+        for (size_t t = 0; t != treeCount; ++t) {
+            stream->read(reinterpret_cast<char*>(&nodeCounts[t]), sizeof(uint8_t));
+            stream->read(reinterpret_cast<char*>(trees[t]), static_cast<std::streamsize>(nodeCounts[t]));
+        }
+
+        // Restart points, symbols of every segment and their bit counts.
+        uint32_t              header[2] = { 0, 0 };
+        std::vector<uint64_t> segmentBits;
+        if (modes & ModeRestart) {
+            stream->read(reinterpret_cast<char*>(header), sizeof(header));
+            segmentBits.resize(header[1]);
+            stream->read(reinterpret_cast<char*>(segmentBits.data()), static_cast<std::streamsize>(header[1] * sizeof(uint64_t)));
+        }
+
+        // Memory streams lend the payload itself, others copy it into buf (or owned without one).
+        std::vector<uint8_t> owned;
+        const uint8_t*       payload = buf;
+        if (!(modes & ModeChunked) || (modes & ModeRestart)) {
+            const size_t totalBytes = (bits >> 3) + ((bits & 0x7) ? 1 : 0);
+            payload = buf ? SbMemoryStream::ReadOrBorrow(stream, buf, totalBytes) : SbMemoryStream::ReadOrBorrow(stream, owned, totalBytes);
+        }
+        else {
+            // A single chunk is decoded where it is, more of them are put together inside buf.
+            bits = 0;
+            for (uint64_t chunkBits = 0; stream->read(reinterpret_cast<char*>(&chunkBits), sizeof(chunkBits)) && chunkBits; bits += chunkBits) {
+                const size_t n = (chunkBits + 7) >> 3;
+                if (!buf) {
+                    // Owned copy grows chunk by chunk, the first one is kept where it is till a second shows up.
+                    if (bits == 0) { payload = SbMemoryStream::ReadOrBorrow(stream, owned, n); continue; }
+                    if (payload != owned.data()) { owned.assign(payload, payload + (bits >> 3)); }
+                    owned.resize((bits >> 3) + n);
+                    payload = owned.data();
+                    uint8_t* const to = owned.data() + (bits >> 3);
+                    if (const uint8_t* chunk = SbMemoryStream::ReadOrBorrow(stream, to, n); chunk != to) { std::memcpy(to, chunk, n); }
+                    continue;
+                }
+                uint8_t* const       to    = buf + (bits >> 3);
+                const uint8_t* const chunk = SbMemoryStream::ReadOrBorrow(stream, to, n);
+                if (bits == 0) { payload = chunk; continue; }
+                if (payload != buf) { std::memcpy(buf, payload, bits >> 3); payload = buf; }
+                if (chunk != to)    { std::memcpy(to, chunk, n); }
+            }
+        }
+
+        // Decoders are built once (one per tree) and shared by all segments.
+        std::optional<SbLUTByteDecoder> lut;
+        std::shared_ptr<const SbIKPByteDecoder> ikp[bandCount];
+        if (decoder == DecoderLUT) {
+            const uint8_t* treeBegs[bandCount] = { trees[0], trees[1], trees[2] };
+            lut.emplace(treeBegs, nodeCounts, treeCount, zeroRuns);
+        }
+        else {
+            // An empty tree is never asked for a symbol, and IKP can't build one. Same trees share the code.
+            for (size_t t = 0; t != treeCount; ++t) { if (nodeCounts[t]) { ikp[t] = SbIKPByteDecoder::Acquire(trees[t], nodeCounts[t], decoder == DecoderIKP); } }
+        }
+        const auto decode = [&](uint8_t* out, const uint8_t* data, size_t n, const Progress& told) {
+            return lut ? (*lut)(out, data, n, told) : DecodeWithIKP(ikp, out, data, n, zeroRuns, banded, told);
+        };
+        if (!(modes & ModeRestart)) {
+            return decode(beg, payload, bits, progress);
+        }
+
+        std::vector<size_t> segmentOffsets(segmentBits.size() + 1, 0);
+        for (size_t i = 0; i != segmentBits.size(); ++i) { segmentOffsets[i + 1] = segmentOffsets[i] + ((segmentBits[i] + 7) >> 3); }
+        std::atomic<size_t> decoded = 0;
+        ParallelRanges(segmentBits.size(), [&](size_t first, size_t last) {
+            for (size_t i = first; i != last; ++i) {
+                decoded += decode(beg + i * header[0], payload + segmentOffsets[i], segmentBits[i], nullptr);
+            }
+        });
+        return decoded;
     }
 }
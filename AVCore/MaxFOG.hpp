@@ -10,6 +10,7 @@
 
 #include <cstdint>
 #include <cstddef>
+#include <functional>
 #include <iosfwd>
 
 namespace SubIT {
@@ -17,13 +18,60 @@ namespace SubIT {
     //======================
     // MaxFOG Coding
     //======================
+    //  Zero run mode: value 0 may appear inside the tree as a run marker, its Golomb code is followed by
+    //    0                   -> End of block, zeros till the end of the current 64 bytes segment.
+    //    1 + ExpGolomb(r-2)  -> A run of r (r >= 2) zeros, never crossing a segment.
+    //  A single 0 bit is still one zero, encoder only uses the marker when it saves bits.
+    //  Restart mode: symbols are cut into segments (multiples of 64) coded one by one and each of them
+    //  starts at a byte, so they can be encoded and decoded in parallel. After the tree comes
+    //    u32 symbols per segment, u32 segment count, u64 bits of every segment
+    //  and "bits encoded" counts all bytes of the segments.
+    //  Band mode: there are three trees (N and tree data each) for DC, low AC and high AC, every symbol
+    //  uses the tree of its position inside 64 symbols, a zero run uses the one where it starts.
+    //  Chunked mode: writer never seeks back, for pipes and other sinks that can't. "Bits encoded" is 0
+    //  and the encoded bits come as chunks of u64 bits plus their bytes, ending with a chunk of 0 bits.
+    //  Only the last chunk may end inside a byte. Restart mode doesn't seek anyway and ignores it.
     class SbCodecMaxFOG {
     public:
+        static constexpr size_t runSegment            = 64;
+        static constexpr size_t defaultRestartSymbols = 64 * 256;
+        static constexpr size_t bandCount             = 3;
+        // Band of a position inside every 64 symbols: DC, low AC and high AC of a zigzag ordered 8x8 block.
+        static constexpr size_t Band   (size_t pos) { pos &= runSegment - 1; return pos == 0 ? 0 : (pos < 16 ? 1 : 2); }
+        // First position after the band of pos inside its 64 symbols.
+        static constexpr size_t BandEnd(size_t pos) { pos &= runSegment - 1; return pos == 0 ? 1 : (pos < 16 ? 16 : 64); }
+        // Stream modes, reader has to be told the same modes as the writer.
+        enum Mode : uint32_t {
+            ModeZeroRun = 1 << 0, // Zero runs and end of blocks, see above.
+            ModeRestart = 1 << 1, // Restart points, see below.
+            ModeBands   = 1 << 2, // One tree per band, see below.
+            ModeChunked = 1 << 3, // Length prefixed chunks of bits, see below.
+        };
+        // Byte decoders, both read the same stream and give the same bytes.
+        enum Decoder : uint8_t {
+            DecoderIKP = 0, // x86-64 JIT, one call per symbol.
+            DecoderLUT = 1, // Portable, several symbols per table lookup.
+            DecoderStatic = 2, // IKP's walk without runtime code, for places where JIT is forbidden.
+        };
+
+        // Called by decoders with how many bytes they have written, about every progressStep of them. Those bytes are
+        // final and can be read by other threads meanwhile.
+        using Progress = std::function<void(size_t)>;
+        static constexpr size_t progressStep = size_t(1) << 14;
+
         static uint8_t*  MakeTree    (uint8_t* treeBeg, uint8_t* beg, uint8_t* end);
-        static size_t    EncodeBytes (uint8_t* beg, uint8_t* end, std::ostream* stream, uint8_t* bitBuffer);
+        // Bits are collected inside bitBuffer and written to stream in bulk, any size works but bigger is better.
+        // When the bits don't fit, stream has to seek back to their count, unless in chunked or restart mode.
+        static size_t    EncodeBytes (uint8_t* beg, uint8_t* end, std::ostream* stream, uint8_t* bitBuffer, size_t bitBufferSize,
+                                      uint32_t modes = 0, size_t restartSymbols = defaultRestartSymbols);
 
         static size_t    GetEncodedBits(std::istream* stream);
-        static size_t    DecodeBits    (uint8_t* beg, size_t bits, std::istream* stream, uint8_t* buf);
+        // buf receives the encoded bytes, unless stream is an SbMemoryStream which lends them without a copy.
+        // A null buf makes the decoder keep its own copy, as big as the payload.
+        // Chunked mode ignores bits and counts them from the chunks. Restart mode decodes segments out of order and never
+        // calls progress.
+        static size_t    DecodeBits    (uint8_t* beg, size_t bits, std::istream* stream, uint8_t* buf, uint32_t modes = 0, Decoder decoder = DecoderLUT,
+                                        const Progress& progress = nullptr);
     };
     
 }
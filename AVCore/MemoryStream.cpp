@@ -0,0 +1,161 @@
+///
+/// \file      MemoryStream.cpp
+/// \brief     Implementation of MemoryStream.hpp
+/// \author    HenryDu
+/// \date      10.16.2026
+/// \copyright © HenryDu 2026. All right reserved.
+///
+
+#include "MemoryStream.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace SubIT {
+
+    SbMemoryStream::Buffer::Buffer(std::span<const std::byte> bytes) {
+        // Get area is never written through, streambuf just wants non const pointers.
+        char* beg = const_cast<char*>(reinterpret_cast<const char*>(bytes.data()));
+        setg(beg, beg, beg + bytes.size());
+    }
+
+    SbMemoryStream::Buffer::pos_type SbMemoryStream::Buffer::seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) {
+        if (!(which & std::ios_base::in)) { return pos_type(off_type(-1)); }
+        const off_type base = (dir == std::ios_base::beg) ? 0 : (dir == std::ios_base::cur) ? gptr() - eback() : egptr() - eback();
+        if (base + off < 0 || base + off > egptr() - eback()) { return pos_type(off_type(-1)); }
+        setg(eback(), eback() + base + off, egptr());
+        return pos_type(base + off);
+    }
+
+    SbMemoryStream::Buffer::pos_type SbMemoryStream::Buffer::seekpos(pos_type pos, std::ios_base::openmode which) {
+        return seekoff(off_type(pos), std::ios_base::beg, which);
+    }
+
+    SbMemoryStream::SbMemoryStream(std::span<const std::byte> bytes) : std::istream(nullptr), buffer(bytes) {
+        rdbuf(&buffer);
+    }
+
+    const uint8_t* SbMemoryStream::Borrow(size_t n) {
+        if (static_cast<size_t>(buffer.egptr() - buffer.gptr()) < n) { return nullptr; }
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(buffer.gptr());
+        buffer.gbump(static_cast<int>(n));
+        return bytes;
+    }
+
+    const uint8_t* SbMemoryStream::ReadOrBorrow(std::istream* stream, uint8_t* buf, size_t n) {
+        // gbump takes an int, bigger payloads are simply read.
+        if (auto* memory = dynamic_cast<SbMemoryStream*>(stream); memory && n <= INT32_MAX) {
+            if (const uint8_t* bytes = memory->Borrow(n)) { return bytes; }
+        }
+        stream->read(reinterpret_cast<char*>(buf), static_cast<std::streamsize>(n));
+        return buf;
+    }
+
+    const uint8_t* SbMemoryStream::ReadOrBorrow(std::istream* stream, std::vector<uint8_t>& owned, size_t n) {
+        if (auto* memory = dynamic_cast<SbMemoryStream*>(stream); memory && n <= INT32_MAX) {
+            if (const uint8_t* bytes = memory->Borrow(n)) { return bytes; }
+        }
+        owned.resize(n);
+        stream->read(reinterpret_cast<char*>(owned.data()), static_cast<std::streamsize>(n));
+        return owned.data();
+    }
+
+    SbSinkStream::Buffer::Buffer(Sink s, size_t size) : sink(std::move(s)), bytes(std::max<size_t>(size, 1)) {
+        setp(bytes.data(), bytes.data() + bytes.size());
+    }
+
+    SbSinkStream::Buffer::int_type SbSinkStream::Buffer::overflow(int_type c) {
+        sync();
+        if (!traits_type::eq_int_type(c, traits_type::eof())) {
+            *pptr() = traits_type::to_char_type(c);
+            pbump(1);
+        }
+        return traits_type::not_eof(c);
+    }
+
+    std::streamsize SbSinkStream::Buffer::xsputn(const char* s, std::streamsize n) {
+        // Whatever doesn't fit goes to the sink as it is, without another copy.
+        if (n <= epptr() - pptr()) {
+            std::memcpy(pptr(), s, static_cast<size_t>(n));
+            pbump(static_cast<int>(n));
+            return n;
+        }
+        sync();
+        sink(std::as_bytes(std::span(s, static_cast<size_t>(n))));
+        return n;
+    }
+
+    int SbSinkStream::Buffer::sync() {
+        if (pptr() != pbase()) {
+            sink(std::as_bytes(std::span(pbase(), pptr())));
+            setp(bytes.data(), bytes.data() + bytes.size());
+        }
+        return 0;
+    }
+
+    SbSinkStream::SbSinkStream(Sink sink, size_t bufferSize) : std::ostream(nullptr), buffer(std::move(sink), bufferSize) {
+        rdbuf(&buffer);
+    }
+
+    SbSinkStream::~SbSinkStream() {
+        buffer.pubsync();
+    }
+
+    SbMappedFile::SbMappedFile(std::string_view filename) {
+        const std::string name(filename);
+#ifdef _WIN32
+        HANDLE file = CreateFileA(name.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        LARGE_INTEGER fileSize{};
+        if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &fileSize)) {
+            if (file != INVALID_HANDLE_VALUE) { CloseHandle(file); }
+            throw std::runtime_error("Error: can't open " + name + ".");
+        }
+        size = static_cast<size_t>(fileSize.QuadPart);
+        // An empty file can't be mapped, it's just no bytes.
+        if (size) {
+            // The view keeps the mapping alive, both handles can go right away.
+            HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            data = mapping ? static_cast<const std::byte*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+            if (mapping) { CloseHandle(mapping); }
+        }
+        CloseHandle(file);
+#else
+        const int   file = ::open(name.c_str(), O_RDONLY);
+        struct stat info{};
+        if (file < 0 || ::fstat(file, &info) != 0) {
+            if (file >= 0) { ::close(file); }
+            throw std::runtime_error("Error: can't open " + name + ".");
+        }
+        size = static_cast<size_t>(info.st_size);
+        if (size) {
+            void* view = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+            data = (view == MAP_FAILED) ? nullptr : static_cast<const std::byte*>(view);
+        }
+        ::close(file);
+#endif
+        if (size && !data) {
+            throw std::runtime_error("Error: can't map " + name + ".");
+        }
+    }
+
+    SbMappedFile::~SbMappedFile() {
+        if (!data) { return; }
+#ifdef _WIN32
+        UnmapViewOfFile(data);
+#else
+        ::munmap(const_cast<std::byte*>(data), size);
+#endif
+    }
+
+}
@@ -0,0 +1,86 @@
+///
+/// \file      MemoryStream.hpp
+/// \brief     Input stream over bytes in memory, read only file mappings and an output stream into a callback.
+/// \details   Entropy decoders borrow their payload from the input stream instead of copying it out.
+/// \author    HenryDu
+/// \date      10.16.2026
+/// \copyright © HenryDu 2026. All right reserved.
+///
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <istream>
+#include <ostream>
+#include <span>
+#include <streambuf>
+#include <string_view>
+#include <vector>
+
+namespace SubIT {
+
+    // std::istream reading straight from bytes owned by someone else, who keeps them alive while it's used.
+    // Everything an istream can do works, and payloads can be borrowed as pointers into the bytes.
+    class SbMemoryStream : public std::istream {
+    public:
+        explicit SbMemoryStream(std::span<const std::byte> bytes);
+        SbMemoryStream(const SbMemoryStream&) = delete;
+        SbMemoryStream& operator=(const SbMemoryStream&) = delete;
+
+        // Skip the next n bytes and return where they are, nullptr (and nothing skipped) if fewer are left.
+        const uint8_t* Borrow(size_t n);
+        // Borrow n bytes from a memory stream, or read them into buf from any other stream.
+        static const uint8_t* ReadOrBorrow(std::istream* stream, uint8_t* buf, size_t n);
+        // Same, but the copy goes into owned, which is only resized when a copy is needed.
+        static const uint8_t* ReadOrBorrow(std::istream* stream, std::vector<uint8_t>& owned, size_t n);
+
+    private:
+        struct Buffer : std::streambuf {
+            explicit Buffer(std::span<const std::byte> bytes);
+            pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override;
+            pos_type seekpos(pos_type pos, std::ios_base::openmode which) override;
+            using std::streambuf::eback, std::streambuf::gptr, std::streambuf::egptr, std::streambuf::gbump;
+        } buffer;
+    };
+
+    // std::ostream handing everything written to a sink, buffer by buffer and on every flush.
+    // It can't seek or tell where it is, just like a pipe, so writers on it have to be single pass.
+    class SbSinkStream : public std::ostream {
+    public:
+        using Sink = std::function<void(std::span<const std::byte>)>;
+
+        explicit SbSinkStream(Sink sink, size_t bufferSize = size_t(1) << 16);
+        // Whatever is left goes to the sink.
+        ~SbSinkStream() override;
+        SbSinkStream(const SbSinkStream&) = delete;
+        SbSinkStream& operator=(const SbSinkStream&) = delete;
+
+    private:
+        struct Buffer : std::streambuf {
+            Buffer(Sink sink, size_t size);
+            int_type        overflow(int_type c) override;
+            std::streamsize xsputn(const char* s, std::streamsize n) override;
+            int             sync() override;
+
+            Sink              sink;
+            std::vector<char> bytes;
+        } buffer;
+    };
+
+    // Whole file mapped read only, bytes stay valid till it's destroyed. Throws when the file can't be mapped.
+    class SbMappedFile {
+    public:
+        explicit SbMappedFile(std::string_view filename);
+        ~SbMappedFile();
+        SbMappedFile(const SbMappedFile&) = delete;
+        SbMappedFile& operator=(const SbMappedFile&) = delete;
+
+        std::span<const std::byte> Bytes() const { return { data, size }; }
+
+    private:
+        const std::byte* data = nullptr;
+        size_t           size = 0;
+    };
+
+}
@@ -10,8 +10,15 @@
 #include "common.hpp"
 #include "OwlVision.hpp"
 #include "MaxFOG.hpp"
+#include "MemoryStream.hpp"
 #include "DCT.hpp"
 #include "SIMD.hpp"
+#include "ThreadPool.hpp"
+
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <sstream>
 
 namespace SubIT {
 
@@ -35,7 +42,12 @@ namespace SubIT {
         return (width * height * 3) >> 1;
     }
 
-    void SbOwlVisionCoreImage::Allocate(void*(* alloc)(size_t size)) {
+    void SbOwlVisionCoreImage::Allocate(void*(* alloc)(size_t size), AllocationMode mode) {
+        if (mode == EntityOnly) {
+            entity = static_cast<uint8_t*>(alloc(size()));
+            shadow = nullptr;
+            return;
+        }
         entity   = static_cast<uint8_t*>(alloc(size() * 5)); // Only one dyncamic allocation.
         shadow = reinterpret_cast<float*>(entity +  size());
     }
@@ -51,10 +63,32 @@ namespace SubIT {
         pi->offset = (pi->id) * (wh) + (p >> 1) * (wh >> 2);
         pi->width  = width  >> pi->id;
         pi->height = height >> pi->id;
+        pi->blockSizeMap = nullptr;
+        pi->zigzag       = false;
+    }
+
+    size_t SbOwlVisionCoreImage::BlockSizeMapSize(const ShadowOperationPipelineInfo& pi) {
+        return ((pi.width + 15) >> 4) * ((pi.height + 15) >> 4);
     }
 
     template void SbOwlVisionCoreImage::ShadowTransformAndQuantize<SbDCT::dirForward>(const ShadowOperationPipelineInfo& pp);
     template void SbOwlVisionCoreImage::ShadowTransformAndQuantize<SbDCT::dirInverse>(const ShadowOperationPipelineInfo& pp);
+    template void SbOwlVisionCoreImage::ShadowFixedTransformAndQuantize<SbDCT::dirForward>(const ShadowOperationPipelineInfo& pp);
+    template void SbOwlVisionCoreImage::ShadowFixedTransformAndQuantize<SbDCT::dirInverse>(const ShadowOperationPipelineInfo& pp);
+    template void SbOwlVisionCoreImage::EntityZigzagLayout<SbDCT::dirForward>(const ShadowOperationPipelineInfo& pp);
+    template void SbOwlVisionCoreImage::EntityZigzagLayout<SbDCT::dirInverse>(const ShadowOperationPipelineInfo& pp);
+    template void SbOwlVisionCoreImage::EntityNormalizedProject<SbDCT::dirForward>(const ShadowOperationPipelineInfo& pp);
+    template void SbOwlVisionCoreImage::EntityNormalizedProject<SbDCT::dirInverse>(const ShadowOperationPipelineInfo& pp);
+    template void SbOwlVisionCoreImage::ShadowMergeBack<SbDCT::dirForward>(const ShadowOperationPipelineInfo& pp);
+    template void SbOwlVisionCoreImage::ShadowMergeBack<SbDCT::dirInverse>(const ShadowOperationPipelineInfo& pp);
+    template void SbOwlVisionCoreImage::EntityFixedProject<SbDCT::dirForward>(const ShadowOperationPipelineInfo& pp);
+    template void SbOwlVisionCoreImage::EntityFixedProject<SbDCT::dirInverse>(const ShadowOperationPipelineInfo& pp);
+    template void SbOwlVisionCoreImage::ShadowFixedMergeBack<SbDCT::dirForward>(const ShadowOperationPipelineInfo& pp);
+    template void SbOwlVisionCoreImage::ShadowFixedMergeBack<SbDCT::dirInverse>(const ShadowOperationPipelineInfo& pp);
+    template void SbOwlVisionCoreImage::EntityFusedTransformAndQuantize<SbDCT::dirForward>(const ShadowOperationPipelineInfo& pp);
+    template void SbOwlVisionCoreImage::EntityFusedTransformAndQuantize<SbDCT::dirInverse>(const ShadowOperationPipelineInfo& pp);
+    template void SbOwlVisionCoreImage::EntityFusedFixedTransformAndQuantize<SbDCT::dirForward>(const ShadowOperationPipelineInfo& pp);
+    template void SbOwlVisionCoreImage::EntityFusedFixedTransformAndQuantize<SbDCT::dirInverse>(const ShadowOperationPipelineInfo& pp);
 
     static constexpr float sShadowNormalBias[4] = {128.F, 128.F, 128.F, 128.F};
     
@@ -77,23 +111,269 @@ namespace SubIT {
         } // for
     }
 
+    // Coefficients of an NxN block grow with N, so VarDCT tables are scaled by N/8 to keep the 8x8 step size,
+    // it also keeps DC of 16x16 and 32x32 blocks inside int8.
+    template <size_t n>
+    static const float* VarDCTQuantTable(size_t id) {
+        static const auto tables = [] {
+            const float* const source[2] = {
+                (n == 4) ? SbOwlVisionConstants::QM4x4[0]   : (n == 8) ? SbOwlVisionConstants::QM8x8[0] :
+                (n == 16) ? SbOwlVisionConstants::QM16x16[0] : SbOwlVisionConstants::QM32x32[0],
+                (n == 4) ? SbOwlVisionConstants::QM4x4[1]   : (n == 8) ? SbOwlVisionConstants::QM8x8[1] :
+                (n == 16) ? SbOwlVisionConstants::QM16x16[1] : SbOwlVisionConstants::QM32x32[1],
+            };
+            struct { alignas(32) float tb[2][n * n]; } scaled {};
+            for (size_t k = 0; k != 2; ++k) {
+                for (size_t i = 0; i != n * n; ++i) { scaled.tb[k][i] = source[k][i] * std::max(static_cast<float>(n) / 8.F, 1.F); }
+            }
+            return scaled;
+        }();
+        return tables.tb[id];
+    }
+
+    template <size_t n, bool dir>
+    static inline void TransformAndQuantizeBlock(float* src, size_t step, size_t id) {
+        SbDCT2 transformer(src, static_cast<ptrdiff_t>(step));
+        const float* tb = VarDCTQuantTable<n>(id);
+        if constexpr (dir == SbDCT::dirForward) {
+            if constexpr (n == 4)  { transformer.Transform4x4<dir>();   transformer.Quantize4x4<dir>(tb); }
+            if constexpr (n == 8)  { transformer.Transform8x8<dir>();   transformer.Quantize8x8<dir>(tb); }
+            if constexpr (n == 16) { transformer.Transform16x16<dir>(); transformer.Quantize16x16<dir>(tb); }
+            if constexpr (n == 32) { transformer.Transform32x32<dir>(); transformer.Quantize32x32<dir>(tb); }
+        }
+        else if constexpr (dir == SbDCT::dirInverse) {
+            if constexpr (n == 4)  { transformer.Quantize4x4<dir>(tb);   transformer.Transform4x4<dir>(); }
+            if constexpr (n == 8)  { transformer.Quantize8x8<dir>(tb);   transformer.Transform8x8<dir>(); }
+            if constexpr (n == 16) { transformer.Quantize16x16<dir>(tb); transformer.Transform16x16<dir>(); }
+            if constexpr (n == 32) { transformer.Quantize32x32<dir>(tb); transformer.Transform32x32<dir>(); }
+        }
+    }
+
+    // Visit every block of a plane in coding order, fn is called as fn.template operator()<n>(x, y).
+    // All 8x8 without a block size map, otherwise cells in raster order and blocks inside a cell in raster order.
+    template <typename Fn>
+    static inline void ForEachBlock(const SbOwlVisionCoreImage::ShadowOperationPipelineInfo& pi, Fn&& fn) {
+        if (!pi.blockSizeMap) {
+            for (size_t y = 0; y != pi.height; y += 8) {
+                for (size_t x = 0; x != pi.width; x += 8) { fn.template operator()<8>(x, y); }
+            }
+            return;
+        }
+        const size_t cellsX = (pi.width + 15) >> 4, cellsY = (pi.height + 15) >> 4;
+        for (size_t cy = 0; cy != cellsY; ++cy) {
+            for (size_t cx = 0; cx != cellsX; ++cx) {
+                const size_t x = cx << 4, w = std::min<size_t>(16, pi.width  - x);
+                const size_t y = cy << 4, h = std::min<size_t>(16, pi.height - y);
+                switch (pi.blockSizeMap[cy * cellsX + cx]) {
+                case SbOwlVisionCoreImage::Block32x32: // Only the top left cell owns the block.
+                    if (!((cx | cy) & 1)) { fn.template operator()<32>(x, y); }
+                    break;
+                case SbOwlVisionCoreImage::Block16x16:
+                    fn.template operator()<16>(x, y);
+                    break;
+                case SbOwlVisionCoreImage::Block4x4:
+                    for (size_t by = 0; by != h; by += 4) {
+                        for (size_t bx = 0; bx != w; bx += 4) { fn.template operator()<4>(x + bx, y + by); }
+                    }
+                    break;
+                default:
+                    for (size_t by = 0; by != h; by += 8) {
+                        for (size_t bx = 0; bx != w; bx += 8) { fn.template operator()<8>(x + bx, y + by); }
+                    }
+                    break;
+                }
+            }
+        }
+    }
+
     template <bool dir>
     void SbOwlVisionCoreImage::ShadowTransformAndQuantize(const ShadowOperationPipelineInfo& pi) {
+        if (pi.blockSizeMap) {
+            ForEachBlock(pi, [&]<size_t n>(size_t x, size_t y) {
+                TransformAndQuantizeBlock<n, dir>(shadow + pi.offset + y * pi.width + x, pi.width, pi.id);
+            });
+            return;
+        }
+        // One block row per call, the transformer walks through all blocks inside.
         for (size_t y = 0; y != pi.height; y += 8) {
-            for (size_t x = 0; x != pi.width; x += 8) {
-                SbDCT2 transformer(shadow + pi.offset + (y * pi.width + x), pi.width);
-                if constexpr (dir == SbDCT::dirForward) {
-                    transformer.Transform8x8<SbDCT::dirForward>();
-                    transformer.Quantize8x8<SbDCT::dirForward>(SbOwlVisionConstants::QM8x8[pi.id]);
+            SbDCT2 transformer(shadow + pi.offset + y * pi.width, pi.width);
+            if constexpr (dir == SbDCT::dirForward) {
+                transformer.Transform8x8N<SbDCT::dirForward>(pi.width >> 3);
+                transformer.Quantize8x8N<SbDCT::dirForward>(SbOwlVisionConstants::QM8x8[pi.id], pi.width >> 3);
+            }
+            else if constexpr (dir == SbDCT::dirInverse) {
+                transformer.Quantize8x8N<SbDCT::dirInverse>(SbOwlVisionConstants::QM8x8[pi.id], pi.width >> 3);
+                transformer.Transform8x8N<SbDCT::dirInverse>(pi.width >> 3);
+            }
+        }
+    }
+
+    template <bool dir>
+    void SbOwlVisionCoreImage::EntityFusedTransformAndQuantize(const ShadowOperationPipelineInfo& pi) {
+        uint8_t* plane = entity + pi.offset;
+        ForEachBlock(pi, [&]<size_t n>(size_t x, size_t y) {
+            alignas(32) float block[n * n];
+            uint8_t* const    at = plane + y * pi.width + x;
+            // Rows of 4x4 blocks are too short for 8 lanes, F2I4 rounds them the same way.
+            for (size_t i = 0; i != n; ++i) {
+                if constexpr (n == 4) {
+                    for (size_t j = 0; j != 4; ++j) {
+                        block[i * 4 + j] = (dir == SbDCT::dirForward) ? static_cast<float>(at[i * pi.width + j]) - 128.F
+                                                                      : static_cast<float>(static_cast<int8_t>(at[i * pi.width + j]));
+                    }
                 }
-                else if constexpr (dir == SbDCT::dirInverse) {
-                    transformer.Quantize8x8<SbDCT::dirInverse>(SbOwlVisionConstants::QM8x8[pi.id]);
-                    transformer.Transform8x8<SbDCT::dirInverse>();
+                else {
+                    for (size_t j = 0; j != n; j += 8) {
+                        if constexpr (dir == SbDCT::dirForward) { SbSIMD::U8ToF8Bias(at + i * pi.width + j, block + i * n + j); }
+                        else if constexpr (dir == SbDCT::dirInverse) { SbSIMD::I8ToF8(reinterpret_cast<const int8_t*>(at + i * pi.width + j), block + i * n + j); }
+                    }
+                }
+            }
+            TransformAndQuantizeBlock<n, dir>(block, n, pi.id);
+            for (size_t i = 0; i != n; ++i) {
+                if constexpr (n == 4) {
+                    float* row = block + i * 4;
+                    if constexpr (dir == SbDCT::dirInverse) { SbSIMD::AddA4(row, sShadowNormalBias); }
+                    SbSIMD::F2I4(row);
+                    for (size_t j = 0; j != 4; ++j) { at[i * pi.width + j] = static_cast<uint8_t>(reinterpret_cast<int*>(row)[j]); }
+                }
+                else {
+                    for (size_t j = 0; j != n; j += 8) {
+                        if constexpr (dir == SbDCT::dirForward) { SbSIMD::F8ToI8(block + i * n + j, reinterpret_cast<int8_t*>(at + i * pi.width + j)); }
+                        else if constexpr (dir == SbDCT::dirInverse) { SbSIMD::F8ToU8Bias(block + i * n + j, at + i * pi.width + j); }
+                    }
+                }
+            }
+        });
+    }
+
+    // Zigzag scan of an NxN block, entry i is the raster index of the i-th coefficient.
+    template <size_t n>
+    static constexpr auto MakeZigzag() {
+        std::array<uint16_t, n * n> order {};
+        size_t i = 0;
+        for (size_t s = 0; s != 2 * n - 1; ++s) {
+            const size_t lo = (s < n) ? 0 : s - n + 1, hi = (s < n) ? s : n - 1;
+            for (size_t k = 0; k != hi - lo + 1; ++k) {
+                const size_t row = (s & 1) ? lo + k : hi - k; // Odd diagonals go down, even ones go up.
+                order[i++] = static_cast<uint16_t>(row * n + (s - row));
+            }
+        }
+        return order;
+    }
+
+    template <size_t n> static constexpr auto sZigzag = MakeZigzag<n>();
+
+    // Rate guess of VarDCT decision in bits: every block ends with an end of block, every non zero level costs a code plus
+    // about two bits per bit of its magnitude, and the zeros before it one run marker. Lambda trades them for squared error.
+    static constexpr int   sLevelBits      = 3;
+    static constexpr int   sRunBits        = 3;
+    static constexpr int   sEndOfBlockBits = 2;
+    static constexpr float sLambda         = 16.F;
+
+    // Squared error plus lambda times the bits of an NxN block at, through the same transform and quantizer as the encoder.
+    // Transforms are orthonormal, so the error of the coefficients is the one of the pixels.
+    template <size_t n>
+    static float BlockCost(const uint8_t* at, size_t stride, size_t id) {
+        alignas(32) float  block[n * n];
+        alignas(32) int8_t levels[n * n];
+        for (size_t i = 0; i != n; ++i) {
+            for (size_t j = 0; j != n; ++j) { block[i * n + j] = static_cast<float>(at[i * stride + j]) - 128.F; }
+        }
+        TransformAndQuantizeBlock<n, SbDCT::dirForward>(block, n, id);
+        // Levels wrap around like the encoder's store does, so an overflowing block is never chosen.
+        for (size_t i = 0; i != n * n; i += 8) { SbSIMD::F8ToI8(block + i, levels + i); }
+        const float* tb = VarDCTQuantTable<n>(id);
+        float lanes[8] = {};
+        for (size_t i = 0; i != n * n; i += 8) {
+            for (size_t k = 0; k != 8; ++k) {
+                const float e = (block[i + k] - static_cast<float>(levels[i + k])) * tb[i + k];
+                lanes[k] += e * e;
+            }
+        }
+        int  bits = sEndOfBlockBits;
+        bool zero = false;
+        for (size_t i = 0; i != n * n; ++i) {
+            const int  q       = levels[sZigzag<n>[i]];
+            const bool nonzero = q != 0;
+            bits += nonzero ? sLevelBits + (zero ? sRunBits : 0) + 2 * static_cast<int>(std::bit_width(static_cast<unsigned>(std::abs(q)))) : 0;
+            zero  = !nonzero;
+        }
+        float distortion = 0.F;
+        for (const float l : lanes) { distortion += l; }
+        return distortion + sLambda * static_cast<float>(bits);
+    }
+
+    // Cost of a w x h region of a plane cut into NxN blocks.
+    template <size_t n>
+    static float RegionCost(const uint8_t* at, size_t stride, size_t w, size_t h, size_t id) {
+        float cost = 0.F;
+        for (size_t y = 0; y != h; y += n) {
+            for (size_t x = 0; x != w; x += n) { cost += BlockCost<n>(at + y * stride + x, stride, id); }
+        }
+        return cost;
+    }
+
+    void SbOwlVisionCoreImage::EntitySelectBlockSize(const ShadowOperationPipelineInfo& pi) const {
+        const uint8_t* plane  = entity + pi.offset;
+        const size_t   cellsX = (pi.width + 15) >> 4, cellsY = (pi.height + 15) >> 4;
+        std::vector<float> costs(cellsX * cellsY);
+        // Cells on the right or bottom edge may only be 8 pixels wide, they can't take a 16x16 block.
+        for (size_t cy = 0; cy != cellsY; ++cy) {
+            for (size_t cx = 0; cx != cellsX; ++cx) {
+                const size_t   w  = std::min<size_t>(16, pi.width  - (cx << 4));
+                const size_t   h  = std::min<size_t>(16, pi.height - (cy << 4));
+                const uint8_t* at = plane + (cy << 4) * pi.width + (cx << 4);
+                uint8_t& cell = pi.blockSizeMap[cy * cellsX + cx];
+                float&   cost = costs[cy * cellsX + cx];
+                cell = Block8x8;
+                cost = RegionCost<8>(at, pi.width, w, h, pi.id);
+                if (const float c = RegionCost<4>(at, pi.width, w, h, pi.id); c < cost) { cell = Block4x4, cost = c; }
+                if (w == 16 && h == 16) {
+                    if (const float c = BlockCost<16>(at, pi.width, pi.id); c < cost) { cell = Block16x16, cost = c; }
+                }
+            }
+        }
+        // Four 16x16 cells on even cell coordinates merge into one 32x32 block when it's cheaper.
+        for (size_t cy = 0; cy + 1 < cellsY; cy += 2) {
+            for (size_t cx = 0; cx + 1 < cellsX; cx += 2) {
+                uint8_t*     cell = pi.blockSizeMap + cy * cellsX + cx;
+                const float* cost = costs.data() + cy * cellsX + cx;
+                if (cell[0] != Block16x16 || cell[1] != Block16x16 || cell[cellsX] != Block16x16 || cell[cellsX + 1] != Block16x16) { continue; }
+                if (BlockCost<32>(plane + (cy << 4) * pi.width + (cx << 4), pi.width, pi.id) < cost[0] + cost[1] + cost[cellsX] + cost[cellsX + 1]) {
+                    cell[0] = cell[1] = cell[cellsX] = cell[cellsX + 1] = Block32x32;
                 }
             }
         }
     }
 
+    template <bool dir>
+    void SbOwlVisionCoreImage::EntityZigzagLayout(const ShadowOperationPipelineInfo& pi) {
+        // Blocks of a strip (8 rows, or 32 with a block size map since 32x32 blocks span two cell rows) pack into exactly
+        // the bytes of that strip, so one strip of scratch is enough.
+        const size_t rows   = pi.blockSizeMap ? 32 : 8;
+        const size_t cellsX = (pi.width + 15) >> 4;
+        std::vector<uint8_t> packed(rows * pi.width);
+        for (size_t y = 0; y < pi.height; y += rows) {
+            ShadowOperationPipelineInfo strip = pi;
+            strip.height       = std::min(rows, pi.height - y);
+            strip.blockSizeMap = pi.blockSizeMap ? pi.blockSizeMap + (y >> 4) * cellsX : nullptr;
+            uint8_t* plane  = entity + pi.offset + y * pi.width;
+            uint8_t* cursor = packed.data();
+            if constexpr (dir == SbDCT::dirInverse) { std::memcpy(packed.data(), plane, strip.height * pi.width); }
+            ForEachBlock(strip, [&]<size_t n>(size_t x, size_t by) {
+                uint8_t* block = plane + by * pi.width + x;
+                for (size_t i = 0; i != n * n; ++i) {
+                    uint8_t& raster = block[(sZigzag<n>[i] / n) * pi.width + (sZigzag<n>[i] % n)];
+                    if constexpr (dir == SbDCT::dirForward) { cursor[i] = raster; }
+                    else if constexpr (dir == SbDCT::dirInverse) { raster = cursor[i]; }
+                }
+                cursor += n * n;
+            });
+            if constexpr (dir == SbDCT::dirForward) { std::memcpy(plane, packed.data(), strip.height * pi.width); }
+        }
+    }
+
     template <bool dir>
     void SbOwlVisionCoreImage::ShadowMergeBack(const ShadowOperationPipelineInfo& pi) {
         for (size_t i = 0; i != pi.size; i += 4) {
@@ -115,52 +395,971 @@ namespace SubIT {
         } // for
     }
 
+    // Raster index to zigzag position of an NxN block.
+    template <size_t n>
+    static constexpr auto MakeZigzagRank() {
+        std::array<uint16_t, n * n> rank {};
+        for (size_t i = 0; i != n * n; ++i) { rank[sZigzag<n>[i]] = static_cast<uint16_t>(i); }
+        return rank;
+    }
+
+    template <size_t n> static constexpr auto sZigzagRank = MakeZigzagRank<n>();
+
+    // m x m inverse transforms of scaled decode gathered eight blocks at a time, block b in lane b.
+    template <size_t m>
+    struct SbScaledInverseBatch {
+        alignas(32) float samples[m * m * 8];
+        uint8_t*          dst[8];
+        size_t            count = 0;
+
+        // Coefficient (u, v) of the next block, already dequantized and scaled.
+        float* Add(uint8_t* to) { dst[count] = to; return samples + count++; }
+
+        void Flush(size_t stride) {
+            if (!count) { return; }
+            SbDCT2 transformer(samples, 8);
+            if constexpr (m == 4) { transformer.Transform4x4x8<SbDCT::dirInverse>(); }
+            if constexpr (m == 8) { transformer.Transform8x8x8<SbDCT::dirInverse>(); }
+            // Eight samples of all blocks turn into eight samples of every block, which are 8 / m rows of it.
+            alignas(32) float rows[64];
+            uint8_t           bytes[8];
+            for (size_t i = 0; i != m * m; i += 8) {
+                SbSIMD::TransposeF8x8(samples + i * 8, rows);
+                for (size_t k = 0; k != count; ++k) {
+                    SbSIMD::F8ToU8BiasSaturate(rows + k * 8, bytes);
+                    for (size_t r = 0; r != 8 / m; ++r) { std::memcpy(dst[k] + (i / m + r) * stride, bytes + r * m, m); }
+                }
+            }
+            count = 0;
+        }
+    };
+
+    void SbOwlVisionCoreImage::EntityScaledInverse(const ShadowOperationPipelineInfo& pi, SbOwlVisionCoreImage* target, const ShadowOperationPipelineInfo& to) const {
+        const size_t   scale  = static_cast<size_t>(std::countr_zero(pi.width / to.width));
+        uint8_t* const out    = target->entity + to.offset;
+        const int8_t*  plane  = reinterpret_cast<const int8_t*>(entity + pi.offset);
+        const int8_t*  cursor = plane;
+        const auto     pixel  = [](float v) { return static_cast<uint8_t>(std::clamp(static_cast<int>(std::floor(v + 128.5F)), 0, 255)); };
+        SbScaledInverseBatch<4> batch4;
+        SbScaledInverseBatch<8> batch8;
+        // Blocks smaller than a pixel of the result (4x4 at 1/8) add their share of it. They only come in whole 16x16 cells,
+        // which are 2x2 pixels there, so the sums are kept for one cell and written when its last block is done.
+        float          sums[2][2] = {};
+        ForEachBlock(pi, [&]<size_t n>(size_t x, size_t y) {
+            constexpr size_t full = n * n;
+            const float*  tb  = VarDCTQuantTable<n>(pi.id);
+            const size_t  m   = n >> scale;
+            uint8_t*      dst = out + (y >> scale) * to.width + (x >> scale);
+            // Low m x m frequencies of an orthonormal NxN transform are an m x m one scaled by N / m, DC / N is the mean.
+            const float   k   = static_cast<float>(m) / static_cast<float>(n);
+            // Low size x size frequencies times f to c[(u * size + v) * step], the layout is picked once per block.
+            const auto    low = [&](float* c, size_t step, size_t size, float f) {
+                if (pi.zigzag) {
+                    for (size_t u = 0; u != size; ++u) {
+                        for (size_t v = 0; v != size; ++v) { c[(u * size + v) * step] = static_cast<float>(cursor[sZigzagRank<n>[u * n + v]]) * tb[u * n + v] * f; }
+                    }
+                    return;
+                }
+                const int8_t* block = plane + y * pi.width + x;
+                for (size_t u = 0; u != size; ++u) {
+                    for (size_t v = 0; v != size; ++v) { c[(u * size + v) * step] = static_cast<float>(block[u * pi.width + v]) * tb[u * n + v] * f; }
+                }
+            };
+            if (m == 0) {
+                const size_t cellX = x & ~size_t(15), cellY = y & ~size_t(15);
+                if (x == cellX && y == cellY) { sums[0][0] = sums[0][1] = sums[1][0] = sums[1][1] = 0.F; }
+                float dc = 0.F;
+                low(&dc, 1, 1, static_cast<float>(full) / static_cast<float>(n) / static_cast<float>(size_t(1) << (scale << 1)));
+                sums[(y >> scale) & 1][(x >> scale) & 1] += dc;
+                const size_t cellW = std::min<size_t>(16, pi.width - cellX), cellH = std::min<size_t>(16, pi.height - cellY);
+                if (x + n == cellX + cellW && y + n == cellY + cellH) {
+                    for (size_t v = 0; v != (cellH >> scale); ++v) {
+                        for (size_t u = 0; u != (cellW >> scale); ++u) { out[((cellY >> scale) + v) * to.width + (cellX >> scale) + u] = pixel(sums[v][u]); }
+                    }
+                }
+            }
+            else if (m == 1) {
+                float dc = 0.F;
+                low(&dc, 1, 1, k);
+                dst[0] = pixel(dc);
+            }
+            else if (m == 2) {
+                float c[4];
+                low(c, 1, 2, k);
+                dst[0]            = pixel(.5F * (c[0] + c[1] + c[2] + c[3]));
+                dst[1]            = pixel(.5F * (c[0] - c[1] + c[2] - c[3]));
+                dst[to.width]     = pixel(.5F * (c[0] + c[1] - c[2] - c[3]));
+                dst[to.width + 1] = pixel(.5F * (c[0] - c[1] - c[2] + c[3]));
+            }
+            else if (m == 4) {
+                low(batch4.Add(dst), 8, 4, k);
+                if (batch4.count == 8) { batch4.Flush(to.width); }
+            }
+            else if constexpr (n >= 16) {
+                if (m == 8) {
+                    low(batch8.Add(dst), 8, 8, k);
+                    if (batch8.count == 8) { batch8.Flush(to.width); }
+                }
+                else if constexpr (n == 32) {
+                    alignas(32) float small[16 * 16];
+                    low(small, 1, 16, k);
+                    SbDCT2 transformer(small, 16);
+                    transformer.Transform16x16<SbDCT::dirInverse>();
+                    for (size_t u = 0; u != 16; ++u) {
+                        for (size_t v = 0; v != 16; v += 8) { SbSIMD::F8ToU8BiasSaturate(small + u * 16 + v, dst + u * to.width + v); }
+                    }
+                }
+            }
+            cursor += full;
+        });
+        batch4.Flush(to.width);
+        batch8.Flush(to.width);
+    }
+
+    // Reciprocals (Q15) and steps for the fixed pipeline, derived from QM8x8 so both pipelines agree.
+    struct SbFixedQuantizeTables { int16_t forward[2][64]; int16_t inverse[2][64]; };
+    static constexpr SbFixedQuantizeTables sFixedQM8x8 = [] {
+        SbFixedQuantizeTables tables = {};
+        for (size_t id = 0; id != 2; ++id) {
+            for (size_t i = 0; i != 64; ++i) {
+                const float step = SbOwlVisionConstants::QM8x8[id][i] * (1 << SbFixedDCT2::fractionBits);
+                tables.forward[id][i] = static_cast<int16_t>(32768.F / step + 0.5F);
+                tables.inverse[id][i] = static_cast<int16_t>(step);
+            }
+        }
+        return tables;
+    }();
+
+    template <bool dir>
+    void SbOwlVisionCoreImage::EntityFixedProject(const ShadowOperationPipelineInfo& pi) {
+        int16_t* fixed = reinterpret_cast<int16_t*>(shadow) + pi.offset;
+        for (size_t i = 0; i != pi.size; i += 16) {
+            if constexpr (dir == SbDCT::dirForward) {
+                SbSIMD::U8ToFixed16(entity + pi.offset + i, fixed + i, SbFixedDCT2::fractionBits);
+            }
+            else if constexpr (dir == SbDCT::dirInverse) {
+                SbSIMD::I8ToI16x16(reinterpret_cast<int8_t*>(entity + pi.offset) + i, fixed + i);
+            }
+        } // for
+    }
+
+    template <bool dir>
+    void SbOwlVisionCoreImage::ShadowFixedTransformAndQuantize(const ShadowOperationPipelineInfo& pi) {
+        int16_t* fixed = reinterpret_cast<int16_t*>(shadow) + pi.offset;
+        for (size_t y = 0; y != pi.height; y += 8) {
+            SbFixedDCT2 transformer(fixed + y * pi.width, pi.width);
+            if constexpr (dir == SbDCT::dirForward) {
+                transformer.Transform8x8N<SbDCT::dirForward>(pi.width >> 3);
+                transformer.Quantize8x8N<SbDCT::dirForward>(sFixedQM8x8.forward[pi.id], pi.width >> 3);
+            }
+            else if constexpr (dir == SbDCT::dirInverse) {
+                transformer.Quantize8x8N<SbDCT::dirInverse>(sFixedQM8x8.inverse[pi.id], pi.width >> 3);
+                transformer.Transform8x8N<SbDCT::dirInverse>(pi.width >> 3);
+            }
+        }
+    }
+
     template <bool dir>
-    static inline auto StartAndExecuteFixedPipeline(SbOwlVisionCoreImage* image, SbOwlVisionCoreImage::PlaneType plane) {
-        SbOwlVisionCoreImage::ShadowOperationPipelineInfo pi;
-        std::invoke(&SbOwlVisionCoreImage::InitShadowOperationPipelineInfo, image, plane, &pi);
-        // Standard pipeline stages.
-        std::invoke(&SbOwlVisionCoreImage::EntityNormalizedProject<dir>, image, pi);
-        std::invoke(&SbOwlVisionCoreImage::ShadowTransformAndQuantize<dir>, image, pi);
-        std::invoke(&SbOwlVisionCoreImage::ShadowMergeBack<dir>, image, pi);
+    void SbOwlVisionCoreImage::ShadowFixedMergeBack(const ShadowOperationPipelineInfo& pi) {
+        int16_t* fixed = reinterpret_cast<int16_t*>(shadow) + pi.offset;
+        for (size_t i = 0; i != pi.size; i += 16) {
+            if constexpr (dir == SbDCT::dirForward) {
+                SbSIMD::I16ToI8x16(fixed + i, reinterpret_cast<int8_t*>(entity + pi.offset) + i);
+            }
+            else if constexpr (dir == SbDCT::dirInverse) {
+                SbSIMD::Fixed16ToU8(fixed + i, entity + pi.offset + i, SbFixedDCT2::fractionBits);
+            }
+        } // for
     }
+
+    template <bool dir>
+    void SbOwlVisionCoreImage::EntityFusedFixedTransformAndQuantize(const ShadowOperationPipelineInfo& pi) {
+        uint8_t* plane = entity + pi.offset;
+        // Two blocks side by side fill an AVX2 register, a last odd block is converted sample by sample.
+        for (size_t y = 0; y != pi.height; y += 8) {
+            for (size_t x = 0; x < pi.width; x += 16) {
+                alignas(32) int16_t blocks[8][16];
+                uint8_t* const      at   = plane + y * pi.width + x;
+                const bool          pair = x + 16 <= pi.width;
+                for (size_t i = 0; i != 8; ++i) {
+                    uint8_t* row = at + i * pi.width;
+                    if (pair) {
+                        if constexpr (dir == SbDCT::dirForward) { SbSIMD::U8ToFixed16(row, blocks[i], SbFixedDCT2::fractionBits); }
+                        else if constexpr (dir == SbDCT::dirInverse) { SbSIMD::I8ToI16x16(reinterpret_cast<const int8_t*>(row), blocks[i]); }
+                        continue;
+                    }
+                    std::fill_n(blocks[i] + 8, 8, int16_t(0));
+                    for (size_t j = 0; j != 8; ++j) {
+                        blocks[i][j] = (dir == SbDCT::dirForward) ? static_cast<int16_t>((row[j] - 128) * (1 << SbFixedDCT2::fractionBits))
+                                                                  : static_cast<int16_t>(static_cast<int8_t>(row[j]));
+                    }
+                }
+                SbFixedDCT2 transformer(blocks[0], 16);
+                if constexpr (dir == SbDCT::dirForward) {
+                    transformer.Transform8x8N<SbDCT::dirForward>(pair ? 2 : 1);
+                    transformer.Quantize8x8N<SbDCT::dirForward>(sFixedQM8x8.forward[pi.id], pair ? 2 : 1);
+                }
+                else if constexpr (dir == SbDCT::dirInverse) {
+                    transformer.Quantize8x8N<SbDCT::dirInverse>(sFixedQM8x8.inverse[pi.id], pair ? 2 : 1);
+                    transformer.Transform8x8N<SbDCT::dirInverse>(pair ? 2 : 1);
+                }
+                for (size_t i = 0; i != 8; ++i) {
+                    uint8_t* row = at + i * pi.width;
+                    if (pair) {
+                        if constexpr (dir == SbDCT::dirForward) { SbSIMD::I16ToI8x16(blocks[i], reinterpret_cast<int8_t*>(row)); }
+                        else if constexpr (dir == SbDCT::dirInverse) { SbSIMD::Fixed16ToU8(blocks[i], row, SbFixedDCT2::fractionBits); }
+                        continue;
+                    }
+                    // Both conversions work on 16 samples, the second half of the row is just scratch.
+                    alignas(16) uint8_t bytes[16];
+                    if constexpr (dir == SbDCT::dirForward) { SbSIMD::I16ToI8x16(blocks[i], reinterpret_cast<int8_t*>(bytes)); }
+                    else if constexpr (dir == SbDCT::dirInverse) { SbSIMD::Fixed16ToU8(blocks[i], bytes, SbFixedDCT2::fractionBits); }
+                    std::memcpy(row, bytes, 8);
+                }
+            }
+        }
+    }
+
+    template <bool dir, bool fixedPoint>
+    static inline auto StartAndExecuteFixedPipeline(SbOwlVisionCoreImage* image, const SbOwlVisionCoreImage::ShadowOperationPipelineInfo& pi) {
+        // Coefficients are back to plane layout before anything else touches them.
+        if (pi.zigzag && dir == SbDCT::dirInverse) {
+            std::invoke(&SbOwlVisionCoreImage::EntityZigzagLayout<dir>, image, pi);
+        }
+        // Fused stages keep every block in L1 instead of streaming the plane through shadow three times.
+        if constexpr (fixedPoint) { std::invoke(&SbOwlVisionCoreImage::EntityFusedFixedTransformAndQuantize<dir>, image, pi); }
+        else                      { std::invoke(&SbOwlVisionCoreImage::EntityFusedTransformAndQuantize<dir>, image, pi); }
+        if (pi.zigzag && dir == SbDCT::dirForward) {
+            std::invoke(&SbOwlVisionCoreImage::EntityZigzagLayout<dir>, image, pi);
+        }
+    }
+
+    // Block size maps of all three planes, only used by "VarDCT" files.
+    struct SbOwlVisionBlockSizeMaps {
+        std::vector<uint8_t> planes[3];
+
+        uint8_t* operator[](SbOwlVisionCoreImage::PlaneType p) { return planes[p].empty() ? nullptr : planes[p].data(); }
+
+        void Resize(const SbOwlVisionCoreImage* image) {
+            for (uint8_t p = 0; p != 3; ++p) {
+                SbOwlVisionCoreImage::ShadowOperationPipelineInfo pi;
+                image->InitShadowOperationPipelineInfo(static_cast<SbOwlVisionCoreImage::PlaneType>(p), &pi);
+                planes[p].assign(SbOwlVisionCoreImage::BlockSizeMapSize(pi), SbOwlVisionCoreImage::Block8x8);
+            }
+        }
+        void Write(std::ostream* out) const {
+            for (const auto& plane : planes) {
+                std::vector<uint8_t> packed((plane.size() + 3) >> 2, 0);
+                for (size_t i = 0; i != plane.size(); ++i) { packed[i >> 2] |= static_cast<uint8_t>(plane[i] << ((i & 3) << 1)); }
+                out->write(reinterpret_cast<const char*>(packed.data()), static_cast<std::streamsize>(packed.size()));
+            }
+        }
+        void Read(std::istream* in) {
+            for (auto& plane : planes) {
+                std::vector<uint8_t> packed((plane.size() + 3) >> 2, 0);
+                in->read(reinterpret_cast<char*>(packed.data()), static_cast<std::streamsize>(packed.size()));
+                for (size_t i = 0; i != plane.size(); ++i) { plane[i] = (packed[i >> 2] >> ((i & 3) << 1)) & 0x3; }
+            }
+        }
+    };
     
-    void SbOwlVisionContainer::operator()(std::istream* in, void*(*alloc)(size_t)) {
+    // Rows of one pipeline task, a row of the biggest (32x32) blocks, so no block or zigzag strip is cut.
+    static constexpr size_t sPipelineBandRows = 32;
+
+    // Bands of all three planes, one pipeline task each.
+    static std::vector<SbOwlVisionCoreImage::ShadowOperationPipelineInfo> PipelineBands(const SbOwlVisionCoreImage* image, uint32_t features,
+                                                                                        SbOwlVisionBlockSizeMaps& maps) {
+        std::vector<SbOwlVisionCoreImage::ShadowOperationPipelineInfo> bands;
+        for (uint8_t p = 0; p != 3; ++p) {
+            SbOwlVisionCoreImage::ShadowOperationPipelineInfo pi;
+            image->InitShadowOperationPipelineInfo(static_cast<SbOwlVisionCoreImage::PlaneType>(p), &pi);
+            pi.blockSizeMap = maps[static_cast<SbOwlVisionCoreImage::PlaneType>(p)];
+            pi.zigzag       = features & SbOwlVisionContainer::Zigzag;
+            const size_t cellsX = (pi.width + 15) >> 4;
+            for (size_t y = 0; y < pi.height; y += sPipelineBandRows) {
+                SbOwlVisionCoreImage::ShadowOperationPipelineInfo band = pi;
+                band.height       = std::min(sPipelineBandRows, pi.height - y);
+                band.size         = band.height * pi.width;
+                band.offset       = pi.offset + y * pi.width;
+                band.blockSizeMap = pi.blockSizeMap ? pi.blockSizeMap + (y >> 4) * cellsX : nullptr;
+                bands.push_back(band);
+            }
+        }
+        return bands;
+    }
+
+    // Run the pipeline of all three planes on the current thread pool.
+    template <bool dir>
+    static void ExecutePipelines(SbOwlVisionCoreImage* image, bool fixedPoint, uint32_t features, SbOwlVisionBlockSizeMaps& maps) {
+        const auto bands = PipelineBands(image, features, maps);
+        // Fixed point pipeline only knows 8x8 blocks.
+        const bool fixed = fixedPoint && !(features & SbOwlVisionContainer::VarDCT);
+        SbThreadPool::Current().ParallelFor(bands.size(), [&](size_t b) {
+            if (fixed) { StartAndExecuteFixedPipeline<dir, true>(image, bands[b]); }
+            else       { StartAndExecuteFixedPipeline<dir, false>(image, bands[b]); }
+        });
+    }
+
+    uint32_t SbOwlVisionContainer::MaxFOGModes(uint32_t features) {
+        return ((features & ZeroRun)   ? static_cast<uint32_t>(SbCodecMaxFOG::ModeZeroRun) : 0u)
+             | ((features & Restart)   ? static_cast<uint32_t>(SbCodecMaxFOG::ModeRestart) : 0u)
+             | ((features & BandTrees) ? static_cast<uint32_t>(SbCodecMaxFOG::ModeBands)   : 0u)
+             | ((features & Chunked)   ? static_cast<uint32_t>(SbCodecMaxFOG::ModeChunked) : 0u);
+    }
+
+    // Ranges of entity coded as one entropy stream each, the whole entity or one per plane.
+    template <typename Fn>
+    static void ForEachEntropyStream(const SbOwlVisionCoreImage* image, uint32_t features, Fn&& fn) {
+        if (!(features & SbOwlVisionContainer::PlaneTrees)) {
+            fn(image->entity, image->size());
+            return;
+        }
+        for (uint8_t p = 0; p != 3; ++p) {
+            SbOwlVisionCoreImage::ShadowOperationPipelineInfo pi;
+            image->InitShadowOperationPipelineInfo(static_cast<SbOwlVisionCoreImage::PlaneType>(p), &pi);
+            fn(image->entity + pi.offset, pi.size);
+        }
+    }
+
+    static constexpr size_t sEntropyBufferSize = size_t(1) << 20;
+
+    // One entropy stream of a body, MaxFOG or rANS as features say.
+    static void EncodeEntropyStream(uint8_t* beg, size_t n, std::ostream* out, uint32_t features) {
+        if (features & SbOwlVisionContainer::RANS) {
+            SbCodecRANS::EncodeBytes(beg, beg + n, out, features & SbOwlVisionContainer::BandTrees);
+            return;
+        }
+        // Bits are written out whenever the buffer fills, bigger buffers only save a few seeks.
+        std::vector<uint8_t> bits(sEntropyBufferSize);
+        SbCodecMaxFOG::EncodeBytes(beg, beg + n, out, bits.data(), bits.size(), SbOwlVisionContainer::MaxFOGModes(features));
+    }
+
+    // Payloads are borrowed from memory streams, otherwise both decoders read them into a buffer of their own.
+    static void DecodeEntropyStream(uint8_t* beg, std::istream* in, uint32_t features, SbCodecMaxFOG::Decoder decoder,
+                                    const SbCodecMaxFOG::Progress& progress = nullptr) {
+        if (features & SbOwlVisionContainer::RANS) {
+            SbCodecRANS::DecodeBytes(beg, in, nullptr, progress);
+            return;
+        }
+        SbCodecMaxFOG::DecodeBits(beg, SbCodecMaxFOG::GetEncodedBits(in), in, nullptr, SbOwlVisionContainer::MaxFOGModes(features), decoder, progress);
+    }
+
+    // First zigzag coefficient of every scan of "Progressive" files, and the end of the last one.
+    static constexpr size_t sScanBegin[4] = { 0, 1, 16, 32 * 32 };
+    static constexpr size_t sScanCount    = 3;
+
+    // Move coefficients of scan s of every block between a zigzag plane and scan, returns how many. Null plane only counts.
+    template <bool dir>
+    static size_t LayoutScan(const SbOwlVisionCoreImage::ShadowOperationPipelineInfo& pi, uint8_t* plane, uint8_t* scan, size_t s) {
+        size_t count = 0;
+        ForEachBlock(pi, [&]<size_t n>(size_t, size_t) {
+            const size_t beg = std::min(sScanBegin[s], n * n), end = std::min(sScanBegin[s + 1], n * n);
+            if (plane) {
+                if constexpr (dir == SbDCT::dirForward) { std::memcpy(scan + count, plane + beg, end - beg); }
+                else if constexpr (dir == SbDCT::dirInverse) { std::memcpy(plane + beg, scan + count, end - beg); }
+                plane += n * n;
+            }
+            count += end - beg;
+        });
+        return count;
+    }
+
+    // Entropy streams of scan s, fn(beg, n) is called after gathering it from coefficients (forward)
+    // or before scattering it back (inverse). Planes are one after another, or one stream each with "PlaneTrees".
+    template <bool dir, typename Fn>
+    static void ForEachScanStream(const SbOwlVisionCoreImage* image, SbOwlVisionBlockSizeMaps& maps, uint8_t* coefficients, uint32_t features, size_t s,
+                                  uint8_t* scan, Fn&& fn) {
+        SbOwlVisionCoreImage::ShadowOperationPipelineInfo pi[3];
+        size_t offsets[4] = {};
+        for (uint8_t p = 0; p != 3; ++p) {
+            image->InitShadowOperationPipelineInfo(static_cast<SbOwlVisionCoreImage::PlaneType>(p), &pi[p]);
+            pi[p].blockSizeMap = maps[static_cast<SbOwlVisionCoreImage::PlaneType>(p)];
+            offsets[p + 1]     = offsets[p] + LayoutScan<dir>(pi[p], nullptr, nullptr, s);
+        }
+        // DC of a block is coded as the difference to the one before it (modulo 256) inside every plane.
+        if constexpr (dir == SbDCT::dirForward) {
+            for (uint8_t p = 0; p != 3; ++p) {
+                LayoutScan<dir>(pi[p], coefficients + pi[p].offset, scan + offsets[p], s);
+                for (size_t i = offsets[p + 1]; s == 0 && i-- > offsets[p] + 1;) { scan[i] = static_cast<uint8_t>(scan[i] - scan[i - 1]); }
+            }
+        }
+        if (features & SbOwlVisionContainer::PlaneTrees) {
+            for (uint8_t p = 0; p != 3; ++p) { fn(scan + offsets[p], offsets[p + 1] - offsets[p]); }
+        }
+        else {
+            fn(scan, offsets[3]);
+        }
+        if constexpr (dir == SbDCT::dirInverse) {
+            for (uint8_t p = 0; p != 3; ++p) {
+                for (size_t i = offsets[p] + 1; s == 0 && i < offsets[p + 1]; ++i) { scan[i] = static_cast<uint8_t>(scan[i] + scan[i - 1]); }
+                LayoutScan<dir>(pi[p], coefficients + pi[p].offset, scan + offsets[p], s);
+            }
+        }
+    }
+
+    // Scans of a "Progressive" body from first to last (excluded) into coefficients, in is at scan first and scan holds
+    // image->size() bytes.
+    static void ReadScans(SbOwlVisionCoreImage* image, std::istream* in, SbOwlVisionBlockSizeMaps& maps, uint8_t* coefficients, uint32_t features,
+                          size_t first, size_t last, uint8_t* scan, SbCodecMaxFOG::Decoder decoder) {
+        for (size_t s = first; s != last; ++s) {
+            ForEachScanStream<SbDCT::dirInverse>(image, maps, coefficients, features, s, scan, [&](uint8_t* beg, size_t) {
+                DecodeEntropyStream(beg, in, features & ~static_cast<uint32_t>(SbOwlVisionContainer::BandTrees), decoder);
+            });
+        }
+    }
+
+    // Entropy streams of a plain body decoded on this thread while pool tasks transform every band as soon as the decoder
+    // is past its last byte, streams and bands both go through entity from front to back.
+    static void DecodeAndExecutePipelines(SbOwlVisionCoreImage* image, std::istream* in, bool fixedPoint, uint32_t features,
+                                          SbOwlVisionBlockSizeMaps& maps, SbCodecMaxFOG::Decoder decoder) {
+        // Tasks may start after this call returned, so whatever they touch lives as long as the last of them.
+        struct Group {
+            std::vector<SbOwlVisionCoreImage::ShadowOperationPipelineInfo> bands;
+            SbOwlVisionCoreImage* image = nullptr;
+            bool                  fixed = false;
+            std::atomic<size_t>   next  = 0, done = 0; // Bands claimed and bands finished.
+        };
+        const auto group = std::make_shared<Group>();
+        group->bands = PipelineBands(image, features, maps);
+        group->image = image;
+        group->fixed = fixedPoint && !(features & SbOwlVisionContainer::VarDCT);
+        // Claim one band and run it, a claim is never ahead of the bands submitted so far.
+        const auto run = [group] {
+            const size_t i = group->next++;
+            if (i >= group->bands.size()) { return; }
+            if (group->fixed) { StartAndExecuteFixedPipeline<SbDCT::dirInverse, true>(group->image, group->bands[i]); }
+            else              { StartAndExecuteFixedPipeline<SbDCT::dirInverse, false>(group->image, group->bands[i]); }
+            ++group->done;
+            group->done.notify_all();
+        };
+        // Wait for claimed bands only, those are running on some thread already.
+        const auto join = [&](size_t claimed) {
+            for (size_t seen = group->done.load(); seen < claimed; seen = group->done.load()) { group->done.wait(seen); }
+        };
+        // Every band is submitted once the decoder has written all of it, nobody waits for bytes.
+        SbThreadPool& pool      = SbThreadPool::Current();
+        size_t        submitted = 0;
+        const auto publish = [&](size_t bytes) {
+            for (; submitted != group->bands.size() && group->bands[submitted].offset + group->bands[submitted].size <= bytes; ++submitted) {
+                pool.Submit(run);
+            }
+        };
+        try {
+            ForEachEntropyStream(image, features, [&](uint8_t* beg, size_t) {
+                const size_t base = static_cast<size_t>(beg - image->entity);
+                DecodeEntropyStream(beg, in, features, decoder, [&](size_t bytes) { publish(base + bytes); });
+            });
+        }
+        catch (...) {
+            join(std::min(group->next.exchange(group->bands.size()), group->bands.size()));
+            throw;
+        }
+        // Bands nobody took yet are run here, tasks which come later find nothing left.
+        while (group->next.load() < group->bands.size()) { run(); }
+        join(group->bands.size());
+    }
+
+    // Forwards what is written to another stream buffer and counts it, for streams which can't tell where they are.
+    class SbCountingBuffer : public std::streambuf {
+    public:
+        explicit SbCountingBuffer(std::streambuf* t) : target(t) {}
+        uint64_t count = 0;
+
+    protected:
+        int_type overflow(int_type c) override {
+            if (traits_type::eq_int_type(c, traits_type::eof())) { return traits_type::not_eof(c); }
+            if (traits_type::eq_int_type(target->sputc(traits_type::to_char_type(c)), traits_type::eof())) { return traits_type::eof(); }
+            ++count;
+            return c;
+        }
+        std::streamsize xsputn(const char* s, std::streamsize n) override {
+            const std::streamsize written = target->sputn(s, n);
+            count += static_cast<uint64_t>(written);
+            return written;
+        }
+        int sync() override { return target->pubsync(); }
+
+    private:
+        std::streambuf* target;
+    };
+
+    // Scratch images of the codec come from ::operator new, this gives them back when the scope is left, errors included.
+    struct SbScopedImage {
+        SbOwlVisionCoreImage* image;
+        ~SbScopedImage() { if (image->entity) { image->Deallocate(::operator delete); } }
+    };
+
+    // Copy a w x h region (even sizes) of all three planes from src at (sx, sy) to dst at (dx, dy).
+    static void CopyRegion(const SbOwlVisionCoreImage& src, size_t sx, size_t sy, SbOwlVisionCoreImage& dst, size_t dx, size_t dy, size_t w, size_t h) {
+        for (uint8_t p = 0; p != 3; ++p) {
+            SbOwlVisionCoreImage::ShadowOperationPipelineInfo from, to;
+            src.InitShadowOperationPipelineInfo(static_cast<SbOwlVisionCoreImage::PlaneType>(p), &from);
+            dst.InitShadowOperationPipelineInfo(static_cast<SbOwlVisionCoreImage::PlaneType>(p), &to);
+            const size_t shift = from.id;
+            for (size_t row = 0; row != (h >> shift); ++row) {
+                std::memcpy(dst.entity + to.offset + ((dy >> shift) + row) * to.width + (dx >> shift),
+                            src.entity + from.offset + ((sy >> shift) + row) * from.width + (sx >> shift), w >> shift);
+            }
+        }
+    }
+
+    void SbOwlVisionContainer::ReadHeader(std::istream* in) {
         // Verify header.
         char header[8] = {};
         in->read(header, 8);
-        if (std::memcmp(header, "SBAV-OVC", 8) != 0) {
+        const bool extended = std::memcmp(header, "SBAV-OVX", 8) == 0;
+        if (std::memcmp(header, "SBAV-OVC", 8) != 0 && !extended) {
             throw std::runtime_error("Error: invalid ovc file.");
         }
         in->read(reinterpret_cast<char*>(&image->width), 8);
         in->read(reinterpret_cast<char*>(&image->height), 8);
+        features = 0;
+        if (extended) {
+            in->read(reinterpret_cast<char*>(&features), 4);
+            if (features & ~static_cast<uint32_t>(VarDCT | Zigzag | ZeroRun | Restart | PlaneTrees | BandTrees | RANS | Tiled | Progressive | Chunked | Strips)) {
+                throw std::runtime_error("Error: unsupported ovc features.");
+            }
+        }
+    }
+
+    void SbOwlVisionContainer::WriteHeader(std::ostream* out, uint32_t headerFeatures) const {
+        out->write(headerFeatures ? "SBAV-OVX" : "SBAV-OVC", 8);
+        out->write(reinterpret_cast<const char*>(&image->width), 8);
+        out->write(reinterpret_cast<const char*>(&image->height), 8);
+        if (headerFeatures) {
+            out->write(reinterpret_cast<const char*>(&headerFeatures), 4);
+        }
+    }
+
+    // Strip rows and picture size of a "Strips" file.
+    static void CheckStrips(const SbOwlVisionCoreImage* image, uint32_t features, uint32_t stripRows) {
+        if (features & SbOwlVisionContainer::Tiled) {
+            throw std::runtime_error("Error: ovc strips can't be tiled.");
+        }
+        if (stripRows == 0 || (stripRows & 0xF) || ((image->width | image->height) & 0xF)) {
+            throw std::runtime_error("Error: invalid ovc strip size.");
+        }
+    }
+
+    // Feature combinations no body can have, reader and writer check the same ones.
+    static void CheckBodyFeatures(uint32_t features) {
+        if ((features & SbOwlVisionContainer::Progressive) && !(features & SbOwlVisionContainer::Zigzag)) {
+            throw std::runtime_error("Error: progressive ovc needs zigzag.");
+        }
+        if ((features & SbOwlVisionContainer::BandTrees) && !(features & SbOwlVisionContainer::Zigzag)) {
+            throw std::runtime_error("Error: ovc band trees need zigzag.");
+        }
+        // Bands are DC, low and high AC of 8x8 blocks, every other block size would be coded with the wrong trees.
+        if ((features & SbOwlVisionContainer::BandTrees) && (features & SbOwlVisionContainer::VarDCT)) {
+            throw std::runtime_error("Error: ovc band trees can't be used with vardct.");
+        }
+    }
+
+    void SbOwlVisionContainer::ReadBody(SbOwlVisionCoreImage* target, std::istream* in, void*(*alloc)(size_t), uint32_t bodyFeatures) const {
+        CheckBodyFeatures(bodyFeatures);
+        SbThreadPool::Scope      scope(pool);
+        SbOwlVisionBlockSizeMaps maps;
+        if (bodyFeatures & VarDCT) {
+            maps.Resize(target);
+            maps.Read(in);
+        }
+
+        if (scale > 3) {
+            throw std::runtime_error("Error: invalid ovc scale.");
+        }
+        if (scale && ((target->width | target->height) & 0xF)) {
+            throw std::runtime_error("Error: ovc size can't be scaled.");
+        }
+        // Scaled decode keeps the full size coefficients to itself, target only gets the small image.
+        SbOwlVisionCoreImage  coefficients(target->width, target->height);
+        SbOwlVisionCoreImage* decoded = scale ? &coefficients : target;
+        const SbScopedImage   coefficientsScope{ &coefficients };
 
         // Allocate it now.
-        image->Allocate(alloc);
+        if (scale) { coefficients.Allocate(::operator new); }
+        else       { target->Allocate(alloc); }
 
         // Write data to memory.
-        SbCodecMaxFOG::DecodeBits(image->entity, SbCodecMaxFOG::GetEncodedBits(in), in, reinterpret_cast<uint8_t*>(image->shadow));
+        if (bodyFeatures & Progressive) {
+            uint64_t sizes[sScanCount] = {};
+            in->read(reinterpret_cast<char*>(sizes), sizeof(sizes));
+            const std::streampos scans = in->tellg();
+            // Low frequencies of 8x8 blocks are all a 1/8 (DC) or 1/4 (2x2) decode looks at.
+            const size_t last = (scale == 3 && !(bodyFeatures & VarDCT)) ? 1 : (scale == 2 && !(bodyFeatures & VarDCT)) ? 2 : sScanCount;
+            std::vector<uint8_t> scan(decoded->size());
+            std::memset(decoded->entity, 0, decoded->size());
+            ReadScans(decoded, in, maps, decoded->entity, bodyFeatures, 0, last, scan.data(), decoder);
+            in->seekg(scans + static_cast<std::streamoff>(sizes[0] + sizes[1] + sizes[2]));
+        }
+        else if (scale || (bodyFeatures & Restart)) {
+            // Restart segments are decoded out of order by all threads at once, they can't be overlapped.
+            ForEachEntropyStream(decoded, bodyFeatures, [&](uint8_t* beg, size_t) { DecodeEntropyStream(beg, in, bodyFeatures, decoder); });
+        }
+        else {
+            DecodeAndExecutePipelines(target, in, fixedPoint, bodyFeatures, maps, decoder);
+            return;
+        }
+
+        if (scale) {
+            target->width  >>= scale;
+            target->height >>= scale;
+            target->Allocate(alloc);
+            // Planes and rows shrink by the same factor, so a band of the small image starts at offset >> (scale * 2).
+            const auto bands = PipelineBands(&coefficients, bodyFeatures, maps);
+            SbThreadPool::Current().ParallelFor(bands.size(), [&](size_t b) {
+                SbOwlVisionCoreImage::ShadowOperationPipelineInfo to = bands[b];
+                to.offset = bands[b].offset >> (scale << 1);
+                to.width  = bands[b].width  >> scale;
+                to.height = bands[b].height >> scale;
+                to.size   = to.width * to.height;
+                coefficients.EntityScaledInverse(bands[b], target, to);
+            });
+            return;
+        }
 
-        // Multi thread optimization.
-        auto f0 = std::async(std::launch::async, StartAndExecuteFixedPipeline<SbDCT::dirInverse>, image, SbOwlVisionCoreImage::Luma);
-        auto f1 = std::async(std::launch::async, StartAndExecuteFixedPipeline<SbDCT::dirInverse>, image, SbOwlVisionCoreImage::ChromaBlue);
-        auto f2 = std::async(std::launch::async, StartAndExecuteFixedPipeline<SbDCT::dirInverse>, image, SbOwlVisionCoreImage::ChromaRed);
+        ExecutePipelines<SbDCT::dirInverse>(target, fixedPoint, bodyFeatures, maps);
     }
 
-    void SbOwlVisionContainer::operator()(std::ostream* out, void*(*alloc)(size_t)) {
-        // Write metadata into file stream.
-        out->write("SBAV-OVC", 8);
-        out->write(reinterpret_cast<char*>(&image->width), 8);
-        out->write(reinterpret_cast<char*>(&image->height), 8);
+    void SbOwlVisionContainer::WriteBody(SbOwlVisionCoreImage* source, std::ostream* out, uint32_t bodyFeatures) const {
+        CheckBodyFeatures(bodyFeatures);
+        SbThreadPool::Scope scope(pool);
+        SbOwlVisionBlockSizeMaps maps;
+        if (bodyFeatures & VarDCT) {
+            maps.Resize(source);
+            // 32x32 blocks never cross a band, so every band decides by itself.
+            const auto bands = PipelineBands(source, bodyFeatures, maps);
+            SbThreadPool::Current().ParallelFor(bands.size(), [&](size_t b) { source->EntitySelectBlockSize(bands[b]); });
+            maps.Write(out);
+        }
         
-        // I don't know why async doesn't work for this part, it should work I mean.
-        std::invoke(StartAndExecuteFixedPipeline<SbDCT::dirForward>, image, SbOwlVisionCoreImage::Luma);
-        std::invoke(StartAndExecuteFixedPipeline<SbDCT::dirForward>, image, SbOwlVisionCoreImage::ChromaBlue);
-        std::invoke(StartAndExecuteFixedPipeline<SbDCT::dirForward>, image, SbOwlVisionCoreImage::ChromaRed);
+        ExecutePipelines<SbDCT::dirForward>(source, fixedPoint, bodyFeatures, maps);
         
         // Next is huffman part (all in one).
-        std::memset(image->shadow, 0, image->size() * sizeof(float));
-        SbCodecMaxFOG::EncodeBytes(image->entity, image->entity + image->size(), out, reinterpret_cast<uint8_t*>(image->shadow));
+        if (!(bodyFeatures & Progressive)) {
+            ForEachEntropyStream(source, bodyFeatures, [&](uint8_t* beg, size_t n) { EncodeEntropyStream(beg, n, out, bodyFeatures); });
+            return;
+        }
+        // Every scan is written by itself first to know its size.
+        std::vector<uint8_t> scan(source->size());
+        std::ostringstream   scans[sScanCount];
+        uint64_t             sizes[sScanCount] = {};
+        for (size_t s = 0; s != sScanCount; ++s) {
+            scans[s] = std::ostringstream(std::ios::binary);
+            ForEachScanStream<SbDCT::dirForward>(source, maps, source->entity, bodyFeatures, s, scan.data(), [&](uint8_t* beg, size_t n) {
+                EncodeEntropyStream(beg, n, &scans[s], bodyFeatures & ~static_cast<uint32_t>(BandTrees));
+            });
+            sizes[s] = static_cast<uint64_t>(scans[s].tellp());
+        }
+        out->write(reinterpret_cast<const char*>(sizes), sizeof(sizes));
+        for (auto& bytes : scans) {
+            const std::string data = std::move(bytes).str();
+            out->write(data.data(), static_cast<std::streamsize>(data.size()));
+        }
+    }
+
+    void SbOwlVisionContainer::operator()(std::istream* in, void*(*alloc)(size_t)) {
+        ReadHeader(in);
+        if (features & (Tiled | Strips)) { ReadRegion(in, alloc, 0, 0, image->width, image->height); }
+        else                             { ReadBody(image, in, alloc, features); }
+    }
+
+    void SbOwlVisionContainer::DecodeRegion(std::istream* in, void*(*alloc)(size_t), size_t x, size_t y, size_t w, size_t h) {
+        ReadHeader(in);
+        ReadRegion(in, alloc, x, y, w, h);
+    }
+
+    void SbOwlVisionContainer::operator()(std::span<const std::byte> in, void*(*alloc)(size_t)) {
+        SbMemoryStream stream(in);
+        (*this)(&stream, alloc);
+    }
+
+    void SbOwlVisionContainer::DecodeRegion(std::span<const std::byte> in, void*(*alloc)(size_t), size_t x, size_t y, size_t w, size_t h) {
+        SbMemoryStream stream(in);
+        DecodeRegion(&stream, alloc, x, y, w, h);
+    }
+
+    void SbOwlVisionContainer::ReadRegion(std::istream* in, void*(*alloc)(size_t), size_t x, size_t y, size_t w, size_t h) {
+        const size_t width = image->width, height = image->height;
+        if (((x | y | w | h) & ((size_t(2) << scale) - 1)) || x + w > width || y + h > height) {
+            throw std::runtime_error("Error: invalid ovc region.");
+        }
+
+        // Everything below is in pixels of the scaled image.
+        if (features & Strips) {
+            // Strips outside the region are seeked past by their sizes, a whole image reads them all in order.
+            in->read(reinterpret_cast<char*>(&stripRows), 4);
+            CheckStrips(image, features, stripRows);
+            image->width = w >> scale, image->height = h >> scale;
+            image->Allocate(alloc);
+            for (size_t stripY = 0; stripY < height; stripY += stripRows) {
+                SbOwlVisionCoreImage strip(width, std::min<size_t>(stripRows, height - stripY));
+                const SbScopedImage  stripScope{ &strip };
+                const size_t fromY = std::max(y, stripY), toY = std::min(y + h, stripY + strip.height);
+                uint64_t     size  = 0;
+                in->read(reinterpret_cast<char*>(&size), 8);
+                if (!*in) {
+                    throw std::runtime_error("Error: ovc stream ended before its last strip.");
+                }
+                if (fromY >= toY) {
+                    in->seekg(static_cast<std::streamoff>(size), std::ios::cur);
+                    continue;
+                }
+                ReadBody(&strip, in, ::operator new, features & ~static_cast<uint32_t>(Strips));
+                CopyRegion(strip, x >> scale, (fromY - stripY) >> scale, *image, 0, (fromY - y) >> scale, w >> scale, (toY - fromY) >> scale);
+            }
+            return;
+        }
+        if (!(features & Tiled)) {
+            SbOwlVisionCoreImage whole(width, height);
+            const SbScopedImage  wholeScope{ &whole };
+            ReadBody(&whole, in, ::operator new, features);
+            image->width = w >> scale, image->height = h >> scale;
+            image->Allocate(alloc);
+            CopyRegion(whole, x >> scale, y >> scale, *image, 0, 0, w >> scale, h >> scale);
+            return;
+        }
+
+        // Tile size, tiles, then their offsets. A whole image reads the tiles in order, a region finds the table at the end
+        // of the stream and seeks to the tiles it touches.
+        in->read(reinterpret_cast<char*>(&tileSize), 4);
+        if (tileSize == 0 || (tileSize & 0xF)) {
+            throw std::runtime_error("Error: invalid ovc tile size.");
+        }
+        const size_t          tilesX = (width + tileSize - 1) / tileSize, tilesY = (height + tileSize - 1) / tileSize;
+        const bool            whole  = x == 0 && y == 0 && w == width && h == height;
+        const std::streampos  tiles  = in->tellg();
+        std::vector<uint64_t> offsets(tilesX * tilesY + 1);
+        const auto            table  = static_cast<std::streamoff>(offsets.size() * sizeof(uint64_t));
+        if (!whole) {
+            in->seekg(-table, std::ios::end);
+            in->read(reinterpret_cast<char*>(offsets.data()), table);
+            if (!*in || offsets[0] != 0 || tiles + static_cast<std::streamoff>(offsets.back()) + table != in->tellg()) {
+                throw std::runtime_error("Error: invalid ovc tile table.");
+            }
+        }
+
+        image->width = w >> scale, image->height = h >> scale;
+        image->Allocate(alloc);
+        for (size_t ty = y / tileSize; ty * tileSize < y + h; ++ty) {
+            for (size_t tx = x / tileSize; tx * tileSize < x + w; ++tx) {
+                // Tile and the part of it inside the region.
+                const size_t tileX = tx * tileSize, tileY = ty * tileSize;
+                SbOwlVisionCoreImage tile(std::min<size_t>(tileSize, width - tileX), std::min<size_t>(tileSize, height - tileY));
+                const SbScopedImage  tileScope{ &tile };
+                const size_t fromX = std::max(x, tileX), toX = std::min(x + w, tileX + tile.width);
+                const size_t fromY = std::max(y, tileY), toY = std::min(y + h, tileY + tile.height);
+                if (!whole) { in->seekg(tiles + static_cast<std::streamoff>(offsets[ty * tilesX + tx])); }
+                ReadBody(&tile, in, ::operator new, features & ~static_cast<uint32_t>(Tiled));
+                CopyRegion(tile, (fromX - tileX) >> scale, (fromY - tileY) >> scale, *image, (fromX - x) >> scale, (fromY - y) >> scale,
+                           (toX - fromX) >> scale, (toY - fromY) >> scale);
+            }
+        }
+        // Leave the stream after the file like a whole decode does.
+        if (whole) { in->ignore(table); }
+        else       { in->seekg(tiles + static_cast<std::streamoff>(offsets.back()) + table); }
+    }
+
+    void SbOwlVisionContainer::operator()(std::ostream* out, void*(*alloc)(size_t)) {
+        if (features & Strips) {
+            // Planes of the image are already in the layout the strip writer takes, one strip after another.
+            SbOwlVisionStripWriter writer(this, out);
+            const size_t wh = image->width * image->height;
+            while (!writer.Complete()) {
+                const size_t row = writer.Rows();
+                writer.Write(image->entity + row * image->width, image->entity + wh + (row >> 1) * (image->width >> 1),
+                             image->entity + wh + (wh >> 2) + (row >> 1) * (image->width >> 1));
+            }
+            out->flush();
+            return;
+        }
+        // Write metadata into file stream.
+        WriteHeader(out, features);
+        if (!(features & Tiled)) {
+            WriteBody(image, out, features);
+            return;
+        }
+
+        // Tiles go straight to out, where each of them ends is told by out or counted when out can't tell (a single pass
+        // body on a pipe), the table of offsets follows them.
+        if (tileSize == 0 || (tileSize & 0xF)) {
+            throw std::runtime_error("Error: invalid ovc tile size.");
+        }
+        out->write(reinterpret_cast<const char*>(&tileSize), 4);
+        const size_t          tilesX = (image->width + tileSize - 1) / tileSize, tilesY = (image->height + tileSize - 1) / tileSize;
+        const std::streampos  tiles  = out->tellp();
+        SbCountingBuffer      counter(out->rdbuf());
+        std::ostream          counted(&counter);
+        std::ostream* const   to     = (tiles == std::streampos(-1)) ? &counted : out;
+        std::vector<uint64_t> offsets(1, 0);
+        for (size_t ty = 0; ty != tilesY; ++ty) {
+            for (size_t tx = 0; tx != tilesX; ++tx) {
+                const size_t tileX = tx * tileSize, tileY = ty * tileSize;
+                SbOwlVisionCoreImage tile(std::min<size_t>(tileSize, image->width - tileX), std::min<size_t>(tileSize, image->height - tileY));
+                const SbScopedImage  tileScope{ &tile };
+                tile.Allocate(::operator new);
+                CopyRegion(*image, tileX, tileY, tile, 0, 0, tile.width, tile.height);
+                WriteBody(&tile, to, features & ~static_cast<uint32_t>(Tiled));
+                offsets.push_back((to == out) ? static_cast<uint64_t>(out->tellp() - tiles) : counter.count);
+            }
+        }
+        out->setstate(counted.rdstate());
+        out->write(reinterpret_cast<const char*>(offsets.data()), static_cast<std::streamsize>(offsets.size() * sizeof(uint64_t)));
+        out->flush();
+    }
+
+    SbOwlVisionProgressiveReader::SbOwlVisionProgressiveReader(SbOwlVisionContainer* c, void*(*alloc)(size_t)) : container(c), allocate(alloc) {}
+
+    SbOwlVisionProgressiveReader::~SbOwlVisionProgressiveReader() = default;
+
+    bool SbOwlVisionProgressiveReader::Feed(const void* data, size_t n) {
+        if (scans == sScanCount) { return false; }
+        bytes.insert(bytes.end(), static_cast<const char*>(data), static_cast<const char*>(data) + n);
+        SbOwlVisionCoreImage* image = container->image;
+
+        // Header, block size maps and scan sizes first, they are parsed once and dropped from bytes, which then starts at
+        // the first scan not decoded yet.
+        if (!maps) {
+            constexpr size_t headerBytes = 28;
+            if (bytes.size() < headerBytes) { return false; }
+            SbOwlVisionCoreImage header;
+            std::memcpy(&header.width,  bytes.data() + 8, 8);
+            std::memcpy(&header.height, bytes.data() + 16, 8);
+            std::memcpy(&features, bytes.data() + 24, 4);
+            if (std::memcmp(bytes.data(), "SBAV-OVX", 8) != 0 || !(features & SbOwlVisionContainer::Progressive)
+                || (features & (SbOwlVisionContainer::Tiled | SbOwlVisionContainer::Strips))) {
+                throw std::runtime_error("Error: ovc is not progressive.");
+            }
+            CheckBodyFeatures(features);
+            size_t sizesAt = headerBytes;
+            for (uint8_t p = 0; p != 3 && (features & SbOwlVisionContainer::VarDCT); ++p) {
+                SbOwlVisionCoreImage::ShadowOperationPipelineInfo pi;
+                header.InitShadowOperationPipelineInfo(static_cast<SbOwlVisionCoreImage::PlaneType>(p), &pi);
+                sizesAt += (SbOwlVisionCoreImage::BlockSizeMapSize(pi) + 3) >> 2;
+            }
+            if (bytes.size() < sizesAt + sizeof(sizes)) { return false; }
+
+            SbMemoryStream in(std::as_bytes(std::span(bytes)));
+            container->ReadHeader(&in);
+            auto blockSizeMaps = std::make_unique<SbOwlVisionBlockSizeMaps>();
+            if (features & SbOwlVisionContainer::VarDCT) {
+                blockSizeMaps->Resize(image);
+                blockSizeMaps->Read(&in);
+            }
+            std::memcpy(sizes, bytes.data() + sizesAt, sizeof(sizes));
+            image->Allocate(allocate);
+            coefficients.assign(image->size(), 0);
+            scan.resize(image->size());
+            maps = std::move(blockSizeMaps);
+            bytes.erase(bytes.begin(), bytes.begin() + static_cast<ptrdiff_t>(sizesAt + sizeof(sizes)));
+        }
+
+        size_t   ready = scans;
+        uint64_t end   = 0;
+        while (ready != sScanCount && end + sizes[ready] <= bytes.size()) { end += sizes[ready++]; }
+        if (ready == scans) { return false; }
+
+        // Scans that came in since last time go into the coefficients, then the image is made again from all of them.
+        SbMemoryStream in(std::as_bytes(std::span(bytes.data(), static_cast<size_t>(end))));
+        ReadScans(image, &in, *maps, coefficients.data(), features, scans, ready, scan.data(), container->decoder);
+        bytes.erase(bytes.begin(), bytes.begin() + static_cast<ptrdiff_t>(end));
+        if (ready == sScanCount) {
+            bytes.shrink_to_fit();
+            scan = {};
+        }
+        std::memcpy(image->entity, coefficients.data(), coefficients.size());
+        SbThreadPool::Scope scope(container->pool);
+        ExecutePipelines<SbDCT::dirInverse>(image, container->fixedPoint, features, *maps);
+        scans = ready;
+        return true;
+    }
+
+    SbOwlVisionStripWriter::SbOwlVisionStripWriter(SbOwlVisionContainer* c, std::ostream* o)
+        : container(c), out(o), features(c->features | SbOwlVisionContainer::Strips) {
+        CheckStrips(container->image, features, container->stripRows);
+        container->WriteHeader(out, features);
+        out->write(reinterpret_cast<const char*>(&container->stripRows), 4);
+        bytes.resize((container->image->width * container->stripRows * 3) >> 1);
+    }
+
+    void SbOwlVisionStripWriter::Write(const uint8_t* y, const uint8_t* cb, const uint8_t* cr) {
+        const size_t width = container->image->width;
+        if (Complete()) {
+            throw std::runtime_error("Error: ovc strips are all written.");
+        }
+        // Strip image borrows bytes, it's transformed in place so the caller's rows stay as they are.
+        SbOwlVisionCoreImage strip(width, std::min<size_t>(container->stripRows, container->image->height - row));
+        strip.entity = bytes.data();
+        const size_t wh = strip.width * strip.height;
+        std::memcpy(strip.entity, y, wh);
+        std::memcpy(strip.entity + wh, cb, wh >> 2);
+        std::memcpy(strip.entity + wh + (wh >> 2), cr, wh >> 2);
+        // Coded into memory first to put its size in front of it, so only one strip's bytes are ever held.
+        std::ostringstream encoded(std::ios::binary);
+        container->WriteBody(&strip, &encoded, features & ~static_cast<uint32_t>(SbOwlVisionContainer::Strips));
+        const std::string data = std::move(encoded).str();
+        const uint64_t    size = data.size();
+        out->write(reinterpret_cast<const char*>(&size), 8);
+        out->write(data.data(), static_cast<std::streamsize>(size));
+        row += strip.height;
+    }
+
+    void SbOwlVisionStripWriter::Write(const Fill& fill) {
+        const size_t width = container->image->width;
+        std::vector<uint8_t> rows(bytes.size());
+        while (!Complete()) {
+            const size_t n  = std::min<size_t>(container->stripRows, container->image->height - row);
+            const size_t wh = width * n;
+            fill(rows.data(), rows.data() + wh, rows.data() + wh + (wh >> 2), row, n);
+            Write(rows.data(), rows.data() + wh, rows.data() + wh + (wh >> 2));
+        }
+    }
+
+    void SbOwlVisionStripWriter::Write(std::istream* yuv) {
+        const std::streampos start  = yuv->tellg();
+        const size_t         width  = container->image->width, wh = width * container->image->height;
+        Write([&](uint8_t* y, uint8_t* cb, uint8_t* cr, size_t first, size_t n) {
+            const auto read = [&](uint8_t* to, size_t offset, size_t count) {
+                yuv->seekg(start + static_cast<std::streamoff>(offset));
+                yuv->read(reinterpret_cast<char*>(to), static_cast<std::streamsize>(count));
+                if (!*yuv) { throw std::runtime_error("Error: yuv stream ended before its last strip."); }
+            };
+            read(y,  first * width, n * width);
+            read(cb, wh + (first >> 1) * (width >> 1), (n * width) >> 2);
+            read(cr, wh + (wh >> 2) + (first >> 1) * (width >> 1), (n * width) >> 2);
+        });
+        // Leave it after the picture like a whole read does.
+        yuv->seekg(start + static_cast<std::streamoff>((wh * 3) >> 1));
+    }
+
+    SbOwlVisionStripReader::SbOwlVisionStripReader(SbOwlVisionContainer* c, std::istream* i) : container(c), in(i), strip(0, 0) {
+        container->ReadHeader(in);
+        if (!(container->features & SbOwlVisionContainer::Strips)) {
+            throw std::runtime_error("Error: ovc is not in strips.");
+        }
+        in->read(reinterpret_cast<char*>(&container->stripRows), 4);
+        CheckStrips(container->image, container->features, container->stripRows);
+        height = container->image->height;
+    }
+
+    SbOwlVisionStripReader::~SbOwlVisionStripReader() {
+        if (strip.entity) { strip.Deallocate(::operator delete); }
+    }
+
+    bool SbOwlVisionStripReader::Next() {
+        if (Complete()) { return false; }
+        if (strip.entity) { strip.Deallocate(::operator delete); }
+        strip.width  = container->image->width;
+        strip.height = std::min<size_t>(container->stripRows, height - next);
+        uint64_t size = 0;
+        in->read(reinterpret_cast<char*>(&size), 8);
+        if (!*in) {
+            throw std::runtime_error("Error: ovc stream ended before its last strip.");
+        }
+        container->ReadBody(&strip, in, ::operator new, container->features & ~static_cast<uint32_t>(SbOwlVisionContainer::Strips));
+        row   = next;
+        next += container->stripRows;
+        next  = std::min(next, height);
+        return true;
     }
 
 }
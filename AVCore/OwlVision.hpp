@@ -12,8 +12,19 @@
 #include <cstdint>
 #include <cstddef>
 #include <iosfwd>
+#include <functional>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "MaxFOG.hpp"
+#include "RANS.hpp"
+#include "ThreadPool.hpp"
 
 namespace SubIT {
+    // Block size maps of "VarDCT" files, only the codec needs to know them.
+    struct SbOwlVisionBlockSizeMaps;
+
 
     class SbOwlVisionConstants {
     public:
@@ -178,12 +189,14 @@ namespace SubIT {
     public:
         // For method mode selection
         enum PlaneType : uint8_t { Luma = 0, ChromaBlue = 1, ChromaRed = 2 };
+        // Transform size of one 16x16 cell of a plane (VarDCT), 32x32 marks all four cells it covers.
+        enum BlockSize : uint8_t { Block8x8 = 0, Block4x4 = 1, Block16x16 = 2, Block32x32 = 3 };
 
         size_t    width;
         size_t    height;
         
         uint8_t  *entity;
-        float    *shadow; // Shadow is only used for doing (un)compression, so we will not deep-copy it.
+        float    *shadow; // Float copy for the three pass stages only, codec never needs it. Not deep-copied.
         
         // You should manage memory allocation your self, which means constructor won't allocate and destructor won't free memory.
         // However, this class provided a function to help you allocate image quickly.
@@ -201,8 +214,10 @@ namespace SubIT {
         bool       SatisfyRestriction() const;
         size_t     size()               const;
 
+        // Entity alone is all the codec needs, shadow (4 bytes a sample) is only there for the three pass stages.
+        enum AllocationMode : uint8_t { EntityOnly = 0, WithShadow = 1 };
         // Manage memory by yourself, data and shadow are together.
-        void       Allocate(void*(*alloc)(size_t size));
+        void       Allocate(void*(*alloc)(size_t size), AllocationMode mode = EntityOnly);
         void       Deallocate(void(dealloc)(void*));
 
         struct ShadowOperationPipelineInfo {
@@ -211,48 +226,244 @@ namespace SubIT {
             size_t width;
             size_t height;
             size_t id;
+            uint8_t* blockSizeMap; // One BlockSize per 16x16 cell in raster order, nullptr means all 8x8.
+            bool     zigzag;       // Coefficients are stored block by block in zigzag order.
         };
         
         void InitShadowOperationPipelineInfo(PlaneType p, ShadowOperationPipelineInfo* pi) const;
+        // How many 16x16 cells (partial ones included) a plane has in its block size map.
+        static size_t BlockSizeMapSize(const ShadowOperationPipelineInfo& pi);
         
-        // Shadow operation pipeline stages.
+        // Encoder side stage (before projection), choose block size of every cell by a rate distortion estimate.
+        void EntitySelectBlockSize(const ShadowOperationPipelineInfo& pi) const;
+        
+        // Shadow operation pipeline stages, they need an image allocated WithShadow.
         template <bool dir> void EntityNormalizedProject(const ShadowOperationPipelineInfo& pi);
         template <bool dir> void ShadowTransformAndQuantize(const ShadowOperationPipelineInfo& pi);
         template <bool dir> void ShadowMergeBack(const ShadowOperationPipelineInfo& pi);
 
+        // Fixed point pipeline stages, shadow holds int16 samples instead of floats.
+        template <bool dir> void EntityFixedProject(const ShadowOperationPipelineInfo& pi);
+        template <bool dir> void ShadowFixedTransformAndQuantize(const ShadowOperationPipelineInfo& pi);
+        template <bool dir> void ShadowFixedMergeBack(const ShadowOperationPipelineInfo& pi);
+
+        // Fused stages, each one does project, transform and quantize and merge back in a single pass. Every block is
+        // loaded from entity onto the stack, transformed and quantized there and stored back, shadow is never touched.
+        // Results are the same as the three stages above. The fixed point one only knows 8x8 blocks.
+        template <bool dir> void EntityFusedTransformAndQuantize(const ShadowOperationPipelineInfo& pi);
+        template <bool dir> void EntityFusedFixedTransformAndQuantize(const ShadowOperationPipelineInfo& pi);
+
+        // Coefficient layout stage, forward gathers every block into zigzag order and packs them one after another,
+        // inverse scatters them back to plane layout. Block order follows the block size map.
+        template <bool dir> void EntityZigzagLayout(const ShadowOperationPipelineInfo& pi);
+
+        // Scaled decode stage, replaces the whole inverse pipeline. Every NxN block of coefficients (plane or zigzag layout)
+        // goes through an inverse transform of its low (N >> scale) x (N >> scale) frequencies only, the result is written
+        // straight into plane to of target, which is 1 << scale times smaller in both directions.
+        void EntityScaledInverse(const ShadowOperationPipelineInfo& pi, SbOwlVisionCoreImage* target, const ShadowOperationPipelineInfo& to) const;
+
     };
 
-    //========================================================
+    //===================================================================
     //        SUB AV "OVC" file description
-    //========================================================
-    //    Bytes     |  Description  |     Value              |
-    //==============|===============|=========================
-    //    [0,7)     |    Header     |  "SBAV-OVC"            |
-    //==============|===============|=========================
-    //    [7,15)    |    Width      |  64 bit little endian  |
-    //==============|===============|=========================
-    //    [15,23)   |    Height     |  64 bit little endian  |
-    //==============|===============|=========================
-    //    [23,31)   | Bits Encoded  |  64 bit little endian  |
-    //==============|===============|=========================
-    //    [31,32)   | Table Size(N) |   8 bit                |
-    //==============|===============|=========================
-    //   [32,32+N)  |  Table Data   |   byte array           |
-    //==============|===============|=========================
-    //  [32+N,EOF)  | Encoded Bits  |  bit stream big endian |
-    //==============|===============|=========================
+    //===================================================================
+    //    Bytes     |  Description  |     Value                         |
+    //==============|===============|====================================
+    //    [0,7)     |    Header     |  "SBAV-OVC" or "SBAV-OVX"         |
+    //==============|===============|====================================
+    //    [7,15)    |    Width      |  64 bit little endian             |
+    //==============|===============|====================================
+    //    [15,23)   |    Height     |  64 bit little endian             |
+    //==============|===============|====================================
+    //    [23,27)   |   Features    |  32 bit little endian, "OVX" only |
+    //==============|===============|====================================
+    //    [27,H)    | Feature Data  |  Feature order, "OVX" only       |
+    //==============|===============|====================================
+    //    [H,H+8)   | Bits Encoded  |  64 bit little endian             |
+    //==============|===============|====================================
+    //  [H+8,H+9)   | Table Size(N) |   8 bit                           |
+    //==============|===============|====================================
+    // [H+9,H+9+N)  |  Table Data   |   byte array                      |
+    //==============|===============|====================================
+    // [H+9+N,EOF)  | Encoded Bits  |  bit stream big endian            |
+    //==============|===============|====================================
+    //  Plain "OVC" files have no features and H is 23.
+    //  Feature data of "VarDCT": block size maps of Y, Cb, Cr, four 2 bit
+    //  cells per byte (low bits first), every plane starts a new byte.
+    //  With "Restart" the restart table of MaxFOG sits between table data and encoded bits.
+    //  With "BandTrees" table size and table data come three times, see SbCodecMaxFOG.
+    //  With "PlaneTrees" everything from H on comes three times, for Y, Cb and Cr.
+    //  With "RANS" everything from H on is a rANS stream instead, see SbCodecRANS.
+    //  With "Chunked" bits encoded is 0 and encoded bits come in length prefixed chunks, see SbCodecMaxFOG.
+    //  Feature data of "Tiled": u32 tile size, then the tiles in raster order. Every tile is a small image
+    //  of its own, coded from its VarDCT maps on with the same features, and edge tiles are cut by the image.
+    //  After the last tile comes a u64 offset of every tile plus one for the end, counted from the first
+    //  tile. Region decodes find this table at the end of the stream.
+    //  Feature data of "Progressive": u64 bytes of each of the three scans, right after the VarDCT maps.
+    //  Scan 0 holds coefficient 0 (DC) of every block as the difference to the DC before it in the same
+    //  plane, scan 1 coefficients 1 to 15, scan 2 the rest, all in zigzag order. Every scan is coded
+    //  like the part from H on, without "BandTrees".
+    //  Feature data of "Strips": u32 strip rows, then the strips from top to bottom (the last one may be shorter),
+    //  each a u64 byte count followed by the strip coded from its VarDCT maps on like a full width image of its
+    //  own. Region decodes seek past strips they don't touch by these counts. Can't be "Tiled".
     //        Class implemented all above.
-    //========================================================
+    //===================================================================
     class SbOwlVisionContainer {
     public:
         // Just bind the image you want to operate on this, and you can start reading or writing it.
+        // Optional file format features, writer uses them as-is and reader fills them from the file.
+        enum Feature : uint32_t {
+            VarDCT  = 1 << 0, // Every 16x16 cell picks 4x4, 8x8, 16x16 or 32x32 transform.
+            Zigzag  = 1 << 1, // Coefficients are coded block by block in zigzag order, no feature data.
+            ZeroRun = 1 << 2, // MaxFOG stream uses zero run mode, best together with Zigzag.
+            Restart = 1 << 3, // MaxFOG stream has restart points, segments are coded in parallel. No feature data.
+            PlaneTrees = 1 << 4, // Y, Cb and Cr are three MaxFOG streams with their own trees. No feature data.
+            BandTrees  = 1 << 5, // MaxFOG streams use band mode (DC, low AC, high AC trees), needs Zigzag and no VarDCT. No feature data.
+            RANS       = 1 << 6, // Streams are SbCodecRANS instead of MaxFOG, ZeroRun and Restart mean nothing then. No feature data.
+            Tiled      = 1 << 7, // Tiles of tileSize pixels are coded one by one, regions decode only the tiles they touch.
+            Progressive = 1 << 8, // DC of all blocks first, then low AC, then high AC, each scan gives a whole image. Needs Zigzag.
+            Chunked    = 1 << 9, // MaxFOG streams are chunked, writer never seeks and works on pipes. No feature data.
+            Strips     = 1 << 10, // Rows are coded a strip at a time, writer and reader only hold one strip. Width and height are multiples of 16.
+        };
+
         SbOwlVisionCoreImage* image;
+        uint32_t              features   = 0;
+        // Use the int16 fixed point pipeline, which is bit-exact across machines and has no float conversion.
+        // It doesn't change the file format, so files can be written by one pipeline and read by another.
+        // Only 8x8 blocks have a fixed point transform, "VarDCT" files always go through the float one.
+        bool                  fixedPoint = false;
+        // Byte decoder of the MaxFOG stream, pick the JIT one to compare against it.
+        SbCodecMaxFOG::Decoder decoder   = SbCodecMaxFOG::DecoderLUT;
+        // Tile width and height of "Tiled" files, a multiple of 16.
+        uint32_t              tileSize   = 256;
+        // Rows of every strip of "Strips" files, a multiple of 16.
+        uint32_t              stripRows  = 16;
+        // Workers of the transform stages and MaxFOG restart segments, nullptr is SbThreadPool::Current().
+        // Many images decoded at once can share one pool instead of each starting threads of its own.
+        SbThreadPool*         pool       = nullptr;
+        // Reader only, decode at 1/2, 1/4 or 1/8 size (1 to 3) with reduced inverse transforms, 0 is full size.
+        // Width and height of the file must be multiples of 16, the float pipeline is always used.
+        uint8_t               scale      = 0;
         // Compressed input and output, results would be stored inside image.
         
         // We assume there are no data inside image.
         void operator()(std::istream* in, void*(*alloc)(size_t));
-        // We assume there already have data inside image.
+        // We assume there already have data inside image. Writer is single pass and never seeks with "Chunked"
+        // or "Restart", so out can be a pipe or an SbSinkStream.
         void operator()(std::ostream* out, void*(*alloc)(size_t));
+        // Decode only the w x h region at (x, y) into image, all of them even (multiples of 2 << scale when scaled,
+        // image gets the scaled region). "Tiled" files seek to the tiles the region touches and skip the others, in has
+        // to end where the file does for them. "Strips" files seek past the strips outside it. Other files are decoded
+        // whole and cropped.
+        void DecodeRegion(std::istream* in, void*(*alloc)(size_t), size_t x, size_t y, size_t w, size_t h);
+        // Same as the two above from a whole file in memory (SbMappedFile for example), entropy decoders read their
+        // payload where it is instead of copying it out.
+        void operator()(std::span<const std::byte> in, void*(*alloc)(size_t));
+        void DecodeRegion(std::span<const std::byte> in, void*(*alloc)(size_t), size_t x, size_t y, size_t w, size_t h);
+        // MaxFOG modes (SbCodecMaxFOG::Mode*) that the entropy streams of a file with these features use.
+        static uint32_t MaxFOGModes(uint32_t features);
+
+    private:
+        friend class SbOwlVisionProgressiveReader;
+        friend class SbOwlVisionStripWriter;
+        friend class SbOwlVisionStripReader;
+
+        void ReadHeader(std::istream* in);
+        // Features of the header are passed in, writers that add one of their own leave features as it is.
+        void WriteHeader(std::ostream* out, uint32_t headerFeatures) const;
+        // Everything after the feature data of a plain file, or one tile of a "Tiled" file.
+        void ReadBody  (SbOwlVisionCoreImage* target, std::istream* in, void*(*alloc)(size_t), uint32_t bodyFeatures) const;
+        void WriteBody (SbOwlVisionCoreImage* source, std::ostream* out, uint32_t bodyFeatures) const;
+        // Region of a file whose header is read.
+        void ReadRegion(std::istream* in, void*(*alloc)(size_t), size_t x, size_t y, size_t w, size_t h);
+    };
+
+    //===================================================================
+    // Incremental reader of "Progressive" files, for bytes that arrive a piece at a time.
+    // Image of the container is allocated once the header is in, then refined every time a scan is
+    // complete: blurry after the DC scan, sharper after low AC and exact after the last one.
+    //===================================================================
+    class SbOwlVisionProgressiveReader {
+    public:
+        SbOwlVisionProgressiveReader(SbOwlVisionContainer* c, void*(*alloc)(size_t));
+        ~SbOwlVisionProgressiveReader();
+        SbOwlVisionProgressiveReader(const SbOwlVisionProgressiveReader&) = delete;
+        SbOwlVisionProgressiveReader& operator=(const SbOwlVisionProgressiveReader&) = delete;
+
+        // Append the next n bytes of the file, returns true if the image has been refined. Bytes after the last scan are ignored.
+        bool   Feed(const void* data, size_t n);
+        // Scans inside the image so far, 3 means the image is complete.
+        size_t Scans()    const { return scans; }
+        bool   Complete() const { return scans == 3; }
+
+    private:
+        SbOwlVisionContainer* container;
+        void*               (*allocate)(size_t);
+        std::vector<char>     bytes;        // From the first scan not decoded yet on, once the header is parsed.
+        std::vector<uint8_t>  coefficients; // Zigzag layout of all scans decoded so far, the rest is zero.
+        std::vector<uint8_t>  scan;         // Scratch of the scan being decoded.
+        std::unique_ptr<SbOwlVisionBlockSizeMaps> maps; // Set once the header is parsed.
+        uint32_t              features = 0;
+        uint64_t              sizes[3] = {}; // Bytes of each scan.
+        size_t                scans = 0;
+    };
+
+    //===================================================================
+    // Bounded memory writer and reader of "Strips" files, for pictures too big to be held at once.
+    // Only one strip (stripRows full width rows of all planes) is in memory, trees are built from
+    // the coefficients of that strip alone, so the source is read once and never seeked back.
+    //===================================================================
+    class SbOwlVisionStripWriter {
+    public:
+        // Rows [row, row + rows) of Y, and rows [row / 2, (row + rows) / 2) of Cb and Cr, into the three planes.
+        using Fill = std::function<void(uint8_t* y, uint8_t* cb, uint8_t* cr, size_t row, size_t rows)>;
+
+        // Header goes out right away, image of the container only tells width and height and needs no memory.
+        SbOwlVisionStripWriter(SbOwlVisionContainer* c, std::ostream* out);
+        ~SbOwlVisionStripWriter() = default;
+        SbOwlVisionStripWriter(const SbOwlVisionStripWriter&) = delete;
+        SbOwlVisionStripWriter& operator=(const SbOwlVisionStripWriter&) = delete;
+
+        // Code the next strip, every plane comes as its rows one after another (width and width / 2 bytes each).
+        void   Write(const uint8_t* y, const uint8_t* cb, const uint8_t* cr);
+        // Code all strips left, asking fill for each of them.
+        void   Write(const Fill& fill);
+        // Code all strips left from a planar YUV420 stream (the layout of entity), it has to seek between planes.
+        void   Write(std::istream* yuv);
+        // Rows coded so far.
+        size_t Rows()     const { return row; }
+        bool   Complete() const { return row == container->image->height; }
+
+    private:
+        SbOwlVisionContainer* container;
+        std::ostream*         out;
+        uint32_t              features; // Of the container plus "Strips".
+        std::vector<uint8_t>  bytes;    // Entity of the strip.
+        size_t                row = 0;
+    };
+
+    class SbOwlVisionStripReader {
+    public:
+        // Header is read right away, image of the container gets width and height of the whole picture but no memory.
+        SbOwlVisionStripReader(SbOwlVisionContainer* c, std::istream* in);
+        ~SbOwlVisionStripReader();
+        SbOwlVisionStripReader(const SbOwlVisionStripReader&) = delete;
+        SbOwlVisionStripReader& operator=(const SbOwlVisionStripReader&) = delete;
+
+        // Decode the next strip, false when there is none left. Strip() then holds it as a full width image whose
+        // first row is Row() of the picture, both scaled when the container is.
+        bool   Next();
+        const SbOwlVisionCoreImage& Strip() const { return strip; }
+        size_t Row()      const { return row >> container->scale; }
+        bool   Complete() const { return next == height; }
+
+    private:
+        SbOwlVisionContainer* container;
+        std::istream*         in;
+        SbOwlVisionCoreImage  strip;
+        size_t                height;   // Of the whole picture, unscaled.
+        size_t                row  = 0; // First row of strip, unscaled.
+        size_t                next = 0; // First row of the strip after it.
     };
 
 }
@@ -0,0 +1,129 @@
+///
+/// \file      OwlVisionAsync.cpp
+/// \brief     Implementation of OwlVisionAsync.hpp
+/// \author    HenryDu
+/// \date      10.16.2026
+/// \copyright © HenryDu 2026. All right reserved.
+///
+
+#include "OwlVisionAsync.hpp"
+#include "MemoryStream.hpp"
+#include "RGBA.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+namespace SubIT {
+
+    SbOwlVisionDecoded::SbOwlVisionDecoded() : image(0, 0) {}
+
+    SbOwlVisionDecoded::~SbOwlVisionDecoded() {
+        if (image.entity) { image.Deallocate(::operator delete); }
+    }
+
+    SbOwlVisionDecoded::SbOwlVisionDecoded(SbOwlVisionDecoded&& other) noexcept : image(std::move(other.image)), rgb(std::move(other.rgb)) {}
+
+    SbOwlVisionDecoded& SbOwlVisionDecoded::operator=(SbOwlVisionDecoded&& other) noexcept {
+        if (this != &other) {
+            if (image.entity) { image.Deallocate(::operator delete); }
+            image = std::exchange(other.image, SbOwlVisionCoreImage(0, 0));
+            rgb   = std::move(other.rgb);
+        }
+        return *this;
+    }
+
+    // Rows of one colour conversion task, even so chroma rows are never split.
+    static constexpr size_t sColourBandRows = 64;
+
+    // State of one request, handed from stage to stage.
+    struct SbOwlVisionDecodeJob {
+        SbOwlVisionDecodeRequest               request;
+        SbOwlVisionAsyncDecoder::Callback      done;
+        SbThreadPool*                          executor;
+        std::unique_ptr<SbMappedFile>          file;
+        SbOwlVisionDecoded                     decoded;
+    };
+    using SbOwlVisionDecodeJobPtr = std::shared_ptr<SbOwlVisionDecodeJob>;
+
+    // Run stage as a task of its own, a throwing stage ends the chain with the error.
+    template <typename Stage>
+    static void Continue(const SbOwlVisionDecodeJobPtr& job, Stage stage) {
+        job->executor->Submit([job, stage] {
+            try { stage(job); }
+            catch (...) { job->done(std::current_exception(), SbOwlVisionDecoded()); }
+        });
+    }
+
+    static void ConvertColour(const SbOwlVisionDecodeJobPtr& job) {
+        SbOwlVisionCoreImage& image = job->decoded.image;
+        if (image.height & 1) {
+            throw std::runtime_error("Error: rgb needs an even height.");
+        }
+        job->decoded.rgb.resize(image.width * image.height * 3);
+        job->executor->ParallelFor((image.height + sColourBandRows - 1) / sColourBandRows, [&](size_t band) {
+            const size_t first = band * sColourBandRows, count = std::min(sColourBandRows, image.height - first);
+            SbRGB{ &image }(job->decoded.rgb.data() + first * image.width * 3, first, count);
+        });
+        job->done(nullptr, std::move(job->decoded));
+    }
+
+    static void DecodeBytes(const SbOwlVisionDecodeJobPtr& job) {
+        const std::span<const std::byte> bytes = job->file ? job->file->Bytes() : job->request.bytes;
+        SbOwlVisionContainer container{ &job->decoded.image };
+        container.scale      = job->request.scale;
+        container.fixedPoint = job->request.fixedPoint;
+        container.decoder    = job->request.decoder;
+        container.pool       = job->executor;
+        container(bytes, ::operator new);
+        job->file.reset();
+        if (job->request.rgb) { Continue(job, ConvertColour); }
+        else                  { job->done(nullptr, std::move(job->decoded)); }
+    }
+
+    static void ReadFile(const SbOwlVisionDecodeJobPtr& job) {
+        job->file = std::make_unique<SbMappedFile>(job->request.filename);
+        Continue(job, DecodeBytes);
+    }
+
+    SbOwlVisionAsyncDecoder::SbOwlVisionAsyncDecoder(SbThreadPool* e) : executor(e ? e : &SbThreadPool::Current()) {}
+
+    void SbOwlVisionAsyncDecoder::Decode(SbOwlVisionDecodeRequest request, Callback done) const {
+        const bool fromFile = request.bytes.empty();
+        auto job = std::make_shared<SbOwlVisionDecodeJob>(SbOwlVisionDecodeJob{ std::move(request), std::move(done), executor, nullptr, {} });
+        if (fromFile) { Continue(job, ReadFile); }
+        else          { Continue(job, DecodeBytes); }
+    }
+
+    std::future<SbOwlVisionDecoded> SbOwlVisionAsyncDecoder::Decode(SbOwlVisionDecodeRequest request) const {
+        auto promise = std::make_shared<std::promise<SbOwlVisionDecoded>>();
+        std::future<SbOwlVisionDecoded> future = promise->get_future();
+        Decode(std::move(request), [promise](std::exception_ptr error, SbOwlVisionDecoded decoded) {
+            if (error) { promise->set_exception(error); }
+            else       { promise->set_value(std::move(decoded)); }
+        });
+        return future;
+    }
+
+    SbOwlVisionAsyncDecoder::Awaitable::Awaitable(const SbOwlVisionAsyncDecoder* d, SbOwlVisionDecodeRequest r) : decoder(d), request(std::move(r)) {}
+
+    void SbOwlVisionAsyncDecoder::Awaitable::await_suspend(std::coroutine_handle<> handle) {
+        // The coroutine may be resumed before this returns, nothing of this awaitable is touched after the call.
+        decoder->Decode(std::move(request), [this, handle](std::exception_ptr e, SbOwlVisionDecoded d) {
+            error   = e;
+            decoded = std::move(d);
+            handle.resume();
+        });
+    }
+
+    SbOwlVisionDecoded SbOwlVisionAsyncDecoder::Awaitable::await_resume() {
+        if (error) { std::rethrow_exception(error); }
+        return std::move(decoded);
+    }
+
+    SbOwlVisionAsyncDecoder::Awaitable SbOwlVisionAsyncDecoder::Await(SbOwlVisionDecodeRequest request) const {
+        return Awaitable(this, std::move(request));
+    }
+
+}
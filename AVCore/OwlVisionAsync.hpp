@@ -0,0 +1,87 @@
+///
+/// \file      OwlVisionAsync.hpp
+/// \brief     Non-blocking OVC decode with futures, callbacks and C++20 coroutines.
+/// \details   Read, decode and colour conversion are tasks of a thread pool, nobody waits for them in a thread of its own.
+/// \author    HenryDu
+/// \date      10.16.2026
+/// \copyright © HenryDu 2026. All right reserved.
+///
+#pragma once
+
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "OwlVision.hpp"
+#include "ThreadPool.hpp"
+
+namespace SubIT {
+
+    // What to decode and how, container settings have the same meaning as in SbOwlVisionContainer.
+    struct SbOwlVisionDecodeRequest {
+        std::string                filename;   // File to map and decode when bytes is empty.
+        std::span<const std::byte> bytes;      // Or a whole file in memory, kept alive by the caller till completion.
+        uint8_t                    scale      = 0;
+        bool                       fixedPoint = false;
+        SbCodecMaxFOG::Decoder     decoder    = SbCodecMaxFOG::DecoderLUT;
+        bool                       rgb        = false; // Convert to packed RGB too, needs an even height.
+    };
+
+    // Decoded image, entity comes from ::operator new and goes back with the result.
+    class SbOwlVisionDecoded {
+    public:
+        SbOwlVisionCoreImage image;
+        std::vector<uint8_t> rgb; // width * height * 3 bytes when asked for, empty otherwise.
+
+        SbOwlVisionDecoded();
+        ~SbOwlVisionDecoded();
+        SbOwlVisionDecoded(SbOwlVisionDecoded&& other) noexcept;
+        SbOwlVisionDecoded& operator=(SbOwlVisionDecoded&& other) noexcept;
+        SbOwlVisionDecoded(const SbOwlVisionDecoded&) = delete;
+        SbOwlVisionDecoded& operator=(const SbOwlVisionDecoded&) = delete;
+    };
+
+    //===================================================================
+    // Every request is a chain of tasks on the pool (read, decode, colour conversion), each one submits the
+    // next, so one thread can keep hundreds of them in flight. Completion comes on a worker of the pool.
+    // A pool without workers runs the whole chain inside the call.
+    //===================================================================
+    class SbOwlVisionAsyncDecoder {
+    public:
+        // error is null on success, decoded is empty otherwise. It must not throw.
+        using Callback = std::function<void(std::exception_ptr error, SbOwlVisionDecoded decoded)>;
+
+        // nullptr is SbThreadPool::Current() of the thread creating the decoder.
+        explicit SbOwlVisionAsyncDecoder(SbThreadPool* executor = nullptr);
+
+        // Both return at once.
+        void                            Decode(SbOwlVisionDecodeRequest request, Callback done) const;
+        std::future<SbOwlVisionDecoded> Decode(SbOwlVisionDecodeRequest request) const;
+
+        // co_await decoder.Await(request) inside a coroutine, which is resumed on a worker of the pool.
+        class Awaitable {
+        public:
+            Awaitable(const SbOwlVisionAsyncDecoder* decoder, SbOwlVisionDecodeRequest request);
+            bool               await_ready() const noexcept { return false; }
+            void               await_suspend(std::coroutine_handle<> handle);
+            SbOwlVisionDecoded await_resume();
+
+        private:
+            const SbOwlVisionAsyncDecoder* decoder;
+            SbOwlVisionDecodeRequest       request;
+            std::exception_ptr             error;
+            SbOwlVisionDecoded             decoded;
+        };
+        Awaitable Await(SbOwlVisionDecodeRequest request) const;
+
+    private:
+        SbThreadPool* executor;
+    };
+
+}
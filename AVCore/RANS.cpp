@@ -0,0 +1,213 @@
+///
+/// \file      RANS.cpp
+/// \brief     Implementation of RANS.hpp
+/// \author    HenryDu
+/// \date      10.16.2026
+/// \copyright © HenryDu 2026. All right reserved.
+///
+
+#include "RANS.hpp"
+#include "MaxFOG.hpp"
+#include "MemoryStream.hpp"
+#include "SIMD.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+namespace SubIT {
+    static constexpr uint32_t sTotal = uint32_t(1) << SbCodecRANS::scaleBits;
+
+    static inline size_t TableOf(size_t pos, bool bands) { return bands ? SbCodecMaxFOG::Band(pos) : 0; }
+
+    // Scale counts so they add up to sTotal, every used symbol keeps at least 1.
+    static void NormalizeFrequencies(const size_t (&counts)[256], uint32_t (&freqs)[256]) {
+        size_t total = 0, largest = 0;
+        for (size_t s = 0; s != 256; ++s) {
+            total += counts[s];
+            if (counts[s] > counts[largest]) { largest = s; }
+        }
+        std::fill(std::begin(freqs), std::end(freqs), 0);
+        if (total == 0) { return; }
+        uint32_t sum = 0;
+        for (size_t s = 0; s != 256; ++s) {
+            if (counts[s] == 0) { continue; }
+            freqs[s] = std::max<uint32_t>(1, static_cast<uint32_t>(counts[s] * sTotal / total));
+            sum += freqs[s];
+        }
+        // Rare symbols rounded up may overshoot, take it back from the biggest ones.
+        while (sum > sTotal) {
+            uint32_t* biggest = std::max_element(std::begin(freqs), std::end(freqs));
+            const uint32_t cut = std::min(*biggest - 1, sum - sTotal);
+            *biggest -= cut;
+            sum      -= cut;
+        }
+        freqs[largest] += sTotal - sum;
+    }
+
+    size_t SbCodecRANS::EncodeBytes(const uint8_t* beg, const uint8_t* end, std::ostream* stream, bool bands) {
+        const size_t count      = static_cast<size_t>(end - beg);
+        const size_t tableCount = bands ? SbCodecMaxFOG::bandCount : 1;
+
+        // Count, normalize and accumulate every table.
+        size_t   counts[SbCodecMaxFOG::bandCount][256] = {};
+        uint32_t freqs [SbCodecMaxFOG::bandCount][256] = {};
+        uint32_t starts[SbCodecMaxFOG::bandCount][256] = {};
+        for (size_t i = 0; i != count; ++i) { ++counts[TableOf(i, bands)][beg[i]]; }
+        for (size_t t = 0; t != tableCount; ++t) {
+            NormalizeFrequencies(counts[t], freqs[t]);
+            for (size_t s = 1; s != 256; ++s) { starts[t][s] = starts[t][s - 1] + freqs[t][s - 1]; }
+        }
+
+        // Code backwards so the decoder goes forwards, every symbol puts out at most one word.
+        std::vector<uint16_t> words(count + states);
+        uint16_t* const wordsEnd = words.data() + words.size();
+        uint16_t*       out      = wordsEnd;
+        uint32_t        x[states];
+        std::fill(std::begin(x), std::end(x), lowBound);
+        for (size_t i = count; i-- != 0;) {
+            const size_t   t     = TableOf(i, bands);
+            const uint32_t freq  = freqs[t][beg[i]];
+            uint32_t&      state = x[i & (states - 1)];
+            if (state >= (uint64_t(freq) << (32 - scaleBits))) {
+                *--out  = static_cast<uint16_t>(state);
+                state >>= 16;
+            }
+            state = ((state / freq) << scaleBits) + (state % freq) + starts[t][beg[i]];
+        }
+
+        const size_t  payloadBytes = static_cast<size_t>(wordsEnd - out) * sizeof(uint16_t);
+        const uint8_t tables       = static_cast<uint8_t>(tableCount);
+        stream->write(reinterpret_cast<const char*>(&payloadBytes), sizeof(size_t));
+        stream->write(reinterpret_cast<const char*>(&count), sizeof(size_t));
+        stream->write(reinterpret_cast<const char*>(&tables), 1);
+        for (size_t t = 0; t != tableCount; ++t) {
+            const uint16_t used = static_cast<uint16_t>(std::count_if(std::begin(freqs[t]), std::end(freqs[t]), [](uint32_t f) { return f != 0; }));
+            stream->write(reinterpret_cast<const char*>(&used), sizeof(uint16_t));
+            for (size_t s = 0; s != 256; ++s) {
+                if (freqs[t][s] == 0) { continue; }
+                const uint8_t  symbol = static_cast<uint8_t>(s);
+                const uint16_t freq   = static_cast<uint16_t>(freqs[t][s]);
+                stream->write(reinterpret_cast<const char*>(&symbol), 1);
+                stream->write(reinterpret_cast<const char*>(&freq), sizeof(uint16_t));
+            }
+        }
+        stream->write(reinterpret_cast<const char*>(x), sizeof(x));
+        stream->write(reinterpret_cast<const char*>(out), static_cast<std::streamsize>(payloadBytes));
+        stream->flush();
+        return payloadBytes;
+    }
+
+    // Slot entry: symbol in bits [0,8), frequency - 1 in [8,20), slot - start in [20,32).
+    static inline uint32_t DecodeStep(uint32_t& x, uint32_t entry) {
+        const uint32_t hi = x >> SbCodecRANS::scaleBits;
+        x = ((entry >> 8) & 0xFFF) * hi + hi + (entry >> 20);
+        return entry & 0xFF;
+    }
+
+#if SB_SIMD_X86 >= SB_SIMD_X86_AVX2
+    // Lanes needing a word take the next ones in lane order, lane j gets the word of its rank among them.
+    static constexpr auto sRefillPermutes = [] {
+        std::array<std::array<uint32_t, 8>, 256> permutes{};
+        for (size_t mask = 0; mask != 256; ++mask) {
+            uint32_t rank = 0;
+            for (size_t lane = 0; lane != 8; ++lane) {
+                permutes[mask][lane] = rank;
+                if (mask & (size_t(1) << lane)) { ++rank; }
+            }
+        }
+        return permutes;
+    }();
+#endif
+
+    size_t SbCodecRANS::DecodeBytes(uint8_t* beg, std::istream* stream, uint8_t* buf, const SbCodecMaxFOG::Progress& progress) {
+        size_t  payloadBytes = 0, count = 0;
+        uint8_t tableCount   = 0;
+        stream->read(reinterpret_cast<char*>(&payloadBytes), sizeof(size_t));
+        stream->read(reinterpret_cast<char*>(&count), sizeof(size_t));
+        stream->read(reinterpret_cast<char*>(&tableCount), 1);
+        const bool bands = tableCount > 1;
+
+        // Slot tables of all tables one after another.
+        std::vector<uint32_t> slots(static_cast<size_t>(tableCount) << scaleBits);
+        for (size_t t = 0; t != tableCount; ++t) {
+            uint16_t used  = 0;
+            uint32_t start = 0;
+            stream->read(reinterpret_cast<char*>(&used), sizeof(uint16_t));
+            for (uint16_t i = 0; i != used; ++i) {
+                uint8_t  symbol = 0;
+                uint16_t freq   = 0;
+                stream->read(reinterpret_cast<char*>(&symbol), 1);
+                stream->read(reinterpret_cast<char*>(&freq), sizeof(uint16_t));
+                if (freq == 0 || start + freq > sTotal) { return 0; } // Broken table.
+                for (uint32_t slot = start; slot != start + freq; ++slot) {
+                    slots[(t << scaleBits) + slot] = symbol | ((freq - 1u) << 8) | ((slot - start) << 20);
+                }
+                start += freq;
+            }
+        }
+        uint32_t x[states] = {};
+        stream->read(reinterpret_cast<char*>(x), sizeof(x));
+        std::vector<uint8_t> owned;
+        const uint8_t* in   = buf ? SbMemoryStream::ReadOrBorrow(stream, buf, payloadBytes) : SbMemoryStream::ReadOrBorrow(stream, owned, payloadBytes);
+        size_t         i    = 0;
+        const uint32_t mask = sTotal - 1;
+        // Steps are multiples of 8 symbols, so i meets every mark exactly.
+        size_t         mark = progress ? SbCodecMaxFOG::progressStep : SIZE_MAX;
+#if SB_SIMD_X86 >= SB_SIMD_X86_AVX2
+        // Table offsets of the 8 groups of 8 symbols inside every 64, only DC differs from its neighbours.
+        alignas(32) uint32_t groupTables[8][8] = {};
+        for (size_t g = 0; g != 8 && bands; ++g) {
+            for (size_t lane = 0; lane != 8; ++lane) { groupTables[g][lane] = static_cast<uint32_t>(SbCodecMaxFOG::Band((g << 3) + lane) << scaleBits); }
+        }
+        const __m256i vmask  = _mm256_set1_epi32(static_cast<int>(mask));
+        const __m256i vbyte  = _mm256_set1_epi32(0xFF);
+        const __m256i vfreq  = _mm256_set1_epi32(0xFFF);
+        const __m256i vzero  = _mm256_setzero_si256();
+        __m256i       vx     = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x));
+        const uint8_t* end   = in + payloadBytes;
+        // Every step loads 16 bytes, the last few words go through the scalar loop to stay inside the payload.
+        for (; i + states <= count && in + 16 <= end; i += states) {
+            if (i == mark) [[unlikely]] { progress(i); mark += SbCodecMaxFOG::progressStep; }
+            const __m256i slot  = _mm256_add_epi32(_mm256_and_si256(vx, vmask), _mm256_load_si256(reinterpret_cast<const __m256i*>(groupTables[(i >> 3) & 7])));
+            const __m256i entry = _mm256_i32gather_epi32(reinterpret_cast<const int*>(slots.data()), slot, 4);
+            const __m256i hi    = _mm256_srli_epi32(vx, scaleBits);
+            vx = _mm256_add_epi32(_mm256_add_epi32(_mm256_mullo_epi32(_mm256_and_si256(_mm256_srli_epi32(entry, 8), vfreq), hi), hi), _mm256_srli_epi32(entry, 20));
+
+            // Symbols, packed down to 4 bytes in each 128 bit half.
+            __m256i symbols = _mm256_and_si256(entry, vbyte);
+            symbols = _mm256_packus_epi32(symbols, symbols);
+            symbols = _mm256_packus_epi16(symbols, symbols);
+            const uint32_t lo4 = static_cast<uint32_t>(_mm256_extract_epi32(symbols, 0)), hi4 = static_cast<uint32_t>(_mm256_extract_epi32(symbols, 4));
+            std::memcpy(beg + i, &lo4, 4);
+            std::memcpy(beg + i + 4, &hi4, 4);
+
+            // Refill lanes below the low bound with the next words.
+            const __m256i refill = _mm256_cmpeq_epi32(_mm256_srli_epi32(vx, 16), vzero);
+            const unsigned lanes = static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(refill)));
+            const __m256i words  = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in)));
+            const __m256i placed = _mm256_permutevar8x32_epi32(words, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(sRefillPermutes[lanes].data())));
+            vx  = _mm256_blendv_epi8(vx, _mm256_or_si256(_mm256_slli_epi32(vx, 16), placed), refill);
+            in += std::popcount(lanes) * sizeof(uint16_t);
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(x), vx);
+#endif
+        for (; i != count; ++i) {
+            if (i == mark) [[unlikely]] { progress(i); mark += SbCodecMaxFOG::progressStep; }
+            uint32_t& state = x[i & (states - 1)];
+            beg[i] = static_cast<uint8_t>(DecodeStep(state, slots[(TableOf(i, bands) << scaleBits) + (state & mask)]));
+            if (state < lowBound) {
+                uint16_t word = 0;
+                std::memcpy(&word, in, sizeof(uint16_t));
+                state = (state << 16) | word;
+                in   += sizeof(uint16_t);
+            }
+        }
+        return count;
+    }
+
+}
@@ -0,0 +1,41 @@
+///
+/// \file      RANS.hpp
+/// \brief     Interleaved rANS coding, the second entropy backend of ovc.
+/// \details   Static frequency tables, 8 states side by side so the decoder can run them in SIMD lanes.
+/// \author    HenryDu
+/// \date      10.16.2026
+/// \copyright © HenryDu 2026. All right reserved.
+///
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <iosfwd>
+
+#include "MaxFOG.hpp"
+
+namespace SubIT {
+    //======================
+    // rANS Coding
+    //======================
+    //  Symbol i is coded by state i % 8, every state is 32 bit and goes out 16 bits at a time.
+    //  Frequencies of every table add up to 1 << scaleBits, each used symbol has at least 1.
+    //  Stream layout:
+    //    u64 payload bytes, u64 symbol count, u8 table count,
+    //    every table: u16 used symbols, then u8 symbol + u16 frequency of each,
+    //    u32 final state of all 8 states, then 16 bit words of the payload.
+    //  Band mode: three tables for DC, low AC and high AC, chosen the same way as SbCodecMaxFOG band mode.
+    class SbCodecRANS {
+    public:
+        static constexpr size_t   states    = 8;
+        static constexpr size_t   scaleBits = 12;
+        static constexpr uint32_t lowBound  = uint32_t(1) << 16;
+
+        // Returns bytes of the payload.
+        static size_t EncodeBytes(const uint8_t* beg, const uint8_t* end, std::ostream* stream, bool bands = false);
+        // buf receives the payload unless stream is an SbMemoryStream, a null buf makes the decoder keep its own copy.
+        // Returns symbols decoded, band mode is told by the table count. progress works as it does for MaxFOG.
+        static size_t DecodeBytes(uint8_t* beg, std::istream* stream, uint8_t* buf, const SbCodecMaxFOG::Progress& progress = nullptr);
+    };
+
+}
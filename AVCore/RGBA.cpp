@@ -12,96 +12,186 @@
 
 namespace SubIT {
 
-    void SbRGBA::operator()(uint8_t *dest) {
-        const size_t u_offset = img->width * img->height;
-        const size_t v_offset = u_offset + (u_offset >> 2);
-        const size_t uv_width = img->width>>1;
-        for(int i = 0; i < img->height>>1; ++i) {
-            for(int j = 0; j < uv_width; ++j) {
-                SbSIMD::yuv2rgba(img->entity[(i<<1)*img->width+(j<<1)], img->entity[u_offset+i*uv_width+j], img->entity[v_offset+i*uv_width+j], dest);
-                SbSIMD::yuv2rgba(img->entity[((i<<1)+1)*img->width+(j<<1)], img->entity[u_offset+i*uv_width+j], img->entity[v_offset+i*uv_width+j], dest);
-                dest += 4;
-                SbSIMD::yuv2rgba(img->entity[(i<<1)*img->width+(j<<1)+1], img->entity[u_offset+i*uv_width+j], img->entity[v_offset+i*uv_width+j], dest);
-                SbSIMD::yuv2rgba(img->entity[((i<<1)+1)*(img->width)+(j<<1)+1], img->entity[u_offset+i*uv_width+j], img->entity[v_offset+i*uv_width+j], dest);
-                dest += 4;
-                ++j;
-                SbSIMD::yuv2rgba(img->entity[(i<<1)*img->width+(j<<1)], img->entity[u_offset+i*uv_width+j], img->entity[v_offset+i*uv_width+j], dest);
-                SbSIMD::yuv2rgba(img->entity[((i<<1)+1)*img->width+(j<<1)], img->entity[u_offset+i*uv_width+j], img->entity[v_offset+i*uv_width+j], dest);
-                dest += 4;
-                SbSIMD::yuv2rgba(img->entity[(i<<1)*img->width+(j<<1)+1], img->entity[u_offset+i*uv_width+j], img->entity[v_offset+i*uv_width+j], dest);
-                SbSIMD::yuv2rgba(img->entity[((i<<1)+1)*(img->width)+(j<<1)+1], img->entity[u_offset+i*uv_width+j], img->entity[v_offset+i*uv_width+j], dest);
-                dest += 4;
-                ++j;
-                SbSIMD::yuv2rgba(img->entity[(i<<1)*img->width+(j<<1)], img->entity[u_offset+i*uv_width+j], img->entity[v_offset+i*uv_width+j], dest);
-                SbSIMD::yuv2rgba(img->entity[((i<<1)+1)*img->width+(j<<1)], img->entity[u_offset+i*uv_width+j], img->entity[v_offset+i*uv_width+j], dest);
-                dest += 4;
-                SbSIMD::yuv2rgba(img->entity[(i<<1)*img->width+(j<<1)+1], img->entity[u_offset+i*uv_width+j], img->entity[v_offset+i*uv_width+j], dest);
-                SbSIMD::yuv2rgba(img->entity[((i<<1)+1)*(img->width)+(j<<1)+1], img->entity[u_offset+i*uv_width+j], img->entity[v_offset+i*uv_width+j], dest);
-                dest += 4;
-                ++j;
-                SbSIMD::yuv2rgba(img->entity[(i<<1)*img->width+(j<<1)], img->entity[u_offset+i*uv_width+j], img->entity[v_offset+i*uv_width+j], dest);
-                SbSIMD::yuv2rgba(img->entity[((i<<1)+1)*img->width+(j<<1)], img->entity[u_offset+i*uv_width+j], img->entity[v_offset+i*uv_width+j], dest);
-                dest += 4;
-                SbSIMD::yuv2rgba(img->entity[(i<<1)*img->width+(j<<1)+1], img->entity[u_offset+i*uv_width+j], img->entity[v_offset+i*uv_width+j], dest);
-                SbSIMD::yuv2rgba(img->entity[((i<<1)+1)*(img->width)+(j<<1)+1], img->entity[u_offset+i*uv_width+j], img->entity[v_offset+i*uv_width+j], dest);
-                dest += 4;
-            }
-            dest += img->width*4;
+    // BT.601 studio range, the same coefficients SbSIMD::yuv2rgba uses. (y - 16) << 7 and (c - 128) << 8 times these
+    // in mulhrs come out with 6 fraction bits, luma is scaled by 2^14 and chroma by 2^13 so all of them fit in 16 bits.
+    static constexpr int16_t sCoefY  = 19077; // 1.16438
+    static constexpr int16_t sCoefRV = 13075; // 1.59603
+    static constexpr int16_t sCoefGU = 3209;  // 0.391761
+    static constexpr int16_t sCoefGV = 6660;  // 0.81297
+    static constexpr int16_t sCoefBU = 16525; // 2.01723
+
+#if SB_SIMD_X86 >= SB_SIMD_X86_AVX2
+    // Chroma term of 16 samples for pixels [0, 16) and [16, 32), every sample covers two of them.
+    static inline void Spread(__m256i t, __m256i& first, __m256i& second) {
+        const __m256i lo = _mm256_unpacklo_epi16(t, t), hi = _mm256_unpackhi_epi16(t, t);
+        first  = _mm256_permute2x128_si256(lo, hi, 0x20);
+        second = _mm256_permute2x128_si256(lo, hi, 0x31);
+    }
+
+    // Luma plus chroma term back to 8 bits, saturated. Result bytes are pixels 0-7, 16-23 | 8-15, 24-31 like packus leaves them.
+    template <bool premultiplied>
+    static inline __m256i Channel(__m256i ya, __m256i yb, __m256i ca, __m256i cb, __m256i alpha) {
+        __m256i a = _mm256_srai_epi16(_mm256_adds_epi16(ya, ca), 6);
+        __m256i b = _mm256_srai_epi16(_mm256_adds_epi16(yb, cb), 6);
+        if constexpr (premultiplied) {
+            // c * alpha / 255 rounded, c clamped first since packus hasn't done it yet.
+            const auto scale = [&](__m256i c) {
+                c = _mm256_min_epi16(_mm256_max_epi16(c, _mm256_setzero_si256()), _mm256_set1_epi16(255));
+                c = _mm256_add_epi16(_mm256_mullo_epi16(c, alpha), _mm256_set1_epi16(128));
+                return _mm256_srli_epi16(_mm256_add_epi16(c, _mm256_srli_epi16(c, 8)), 8);
+            };
+            a = scale(a);
+            b = scale(b);
         }
+        return _mm256_packus_epi16(a, b);
     }
 
-    void SbRGB::operator()(uint8_t* dest) {
-        const size_t u_offset = img->width * img->height;
-        const size_t v_offset = u_offset + (u_offset >> 2);
-        const size_t uv_width = img->width>>1;
-        uint8_t rgba[4];
-        for(int i = 0; i < img->height>>1; ++i) {
-            for(int j = 0; j < uv_width; ++j) {
-                SbSIMD::yuv2rgba(img->entity[(i<<1)*img->width+(j<<1)], img->entity[u_offset+i*uv_width+j], img->entity[v_offset+i*uv_width+j], rgba);
-                std::memcpy(dest, rgba, 3);
-                SbSIMD::yuv2rgba(img->entity[((i<<1)+1)*img->width+(j<<1)], img->entity[u_offset+i*uv_width+j], img->entity[v_offset+i*uv_width+j], rgba);
-                std::memcpy(dest+img->width*3, rgba, 3);
-                dest += 3;
-                SbSIMD::yuv2rgba(img->entity[(i<<1)*img->width+(j<<1)+1], img->entity[u_offset+i*uv_width+j], img->entity[v_offset+i*uv_width+j], rgba);
-                std::memcpy(dest, rgba, 3);
-                SbSIMD::yuv2rgba(img->entity[((i<<1)+1)*(img->width)+(j<<1)+1], img->entity[u_offset+i*uv_width+j], img->entity[v_offset+i*uv_width+j], rgba);
-                std::memcpy(dest+img->width*3, rgba, 3);
-                dest += 3;
-                ++j;
-                SbSIMD::yuv2rgba(img->entity[(i<<1)*img->width+(j<<1)], img->entity[u_offset+i*uv_width+j], img->entity[v_offset+i*uv_width+j], rgba);
-                std::memcpy(dest, rgba, 3);
-                SbSIMD::yuv2rgba(img->entity[((i<<1)+1)*img->width+(j<<1)], img->entity[u_offset+i*uv_width+j], img->entity[v_offset+i*uv_width+j], rgba);
-                std::memcpy(dest+img->width*3, rgba, 3);
-                dest += 3;
-                SbSIMD::yuv2rgba(img->entity[(i<<1)*img->width+(j<<1)+1], img->entity[u_offset+i*uv_width+j], img->entity[v_offset+i*uv_width+j], rgba);
-                std::memcpy(dest, rgba, 3);
-                SbSIMD::yuv2rgba(img->entity[((i<<1)+1)*(img->width)+(j<<1)+1], img->entity[u_offset+i*uv_width+j], img->entity[v_offset+i*uv_width+j], rgba);
-                std::memcpy(dest+img->width*3, rgba, 3);
-                dest += 3;
-                ++j;
-                SbSIMD::yuv2rgba(img->entity[(i<<1)*img->width+(j<<1)], img->entity[u_offset+i*uv_width+j], img->entity[v_offset+i*uv_width+j], rgba);
-                std::memcpy(dest, rgba, 3);
-                SbSIMD::yuv2rgba(img->entity[((i<<1)+1)*img->width+(j<<1)], img->entity[u_offset+i*uv_width+j], img->entity[v_offset+i*uv_width+j], rgba);
-                std::memcpy(dest+img->width*3, rgba, 3);
-                dest += 3;
-                SbSIMD::yuv2rgba(img->entity[(i<<1)*img->width+(j<<1)+1], img->entity[u_offset+i*uv_width+j], img->entity[v_offset+i*uv_width+j], rgba);
-                std::memcpy(dest, rgba, 3);
-                SbSIMD::yuv2rgba(img->entity[((i<<1)+1)*(img->width)+(j<<1)+1], img->entity[u_offset+i*uv_width+j], img->entity[v_offset+i*uv_width+j], rgba);
-                std::memcpy(dest+img->width*3, rgba, 3);
-                dest += 3;
-                ++j;
-                SbSIMD::yuv2rgba(img->entity[(i<<1)*img->width+(j<<1)], img->entity[u_offset+i*uv_width+j], img->entity[v_offset+i*uv_width+j], rgba);
-                std::memcpy(dest, rgba, 3);
-                SbSIMD::yuv2rgba(img->entity[((i<<1)+1)*img->width+(j<<1)], img->entity[u_offset+i*uv_width+j], img->entity[v_offset+i*uv_width+j], rgba);
-                std::memcpy(dest+img->width*3, rgba, 3);
-                dest += 3;
-                SbSIMD::yuv2rgba(img->entity[(i<<1)*img->width+(j<<1)+1], img->entity[u_offset+i*uv_width+j], img->entity[v_offset+i*uv_width+j], rgba);
-                std::memcpy(dest, rgba, 3);
-                SbSIMD::yuv2rgba(img->entity[((i<<1)+1)*(img->width)+(j<<1)+1], img->entity[u_offset+i*uv_width+j], img->entity[v_offset+i*uv_width+j], rgba);
-                std::memcpy(dest+img->width*3, rgba, 3);
-                dest += 3;
+    // Interleave four channels of 32 pixels in packus order into 128 bytes of dest.
+    static inline void Store4(__m256i c0, __m256i c1, __m256i c2, __m256i c3, uint8_t* dest) {
+        const __m256i lo01 = _mm256_unpacklo_epi8(c0, c1), hi01 = _mm256_unpackhi_epi8(c0, c1);
+        const __m256i lo23 = _mm256_unpacklo_epi8(c2, c3), hi23 = _mm256_unpackhi_epi8(c2, c3);
+        const __m256i p0 = _mm256_unpacklo_epi16(lo01, lo23), p1 = _mm256_unpackhi_epi16(lo01, lo23);
+        const __m256i p2 = _mm256_unpacklo_epi16(hi01, hi23), p3 = _mm256_unpackhi_epi16(hi01, hi23);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest),      _mm256_permute2x128_si256(p0, p1, 0x20));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + 32), _mm256_permute2x128_si256(p0, p1, 0x31));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + 64), _mm256_permute2x128_si256(p2, p3, 0x20));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + 96), _mm256_permute2x128_si256(p2, p3, 0x31));
+    }
+
+    // The same without the fourth channel into 96 bytes, each 8 pixels are squeezed into the low 24 bytes first.
+    static inline void Store3(__m256i c0, __m256i c1, __m256i c2, uint8_t* dest) {
+        const __m256i squeeze = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+                                                 0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+        const __m256i lanes   = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7);
+        const auto pack = [&](__m256i v) { return _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(v, squeeze), lanes); };
+        const __m256i lo01 = _mm256_unpacklo_epi8(c0, c1), hi01 = _mm256_unpackhi_epi8(c0, c1);
+        const __m256i lo2  = _mm256_unpacklo_epi8(c2, c2), hi2  = _mm256_unpackhi_epi8(c2, c2);
+        const __m256i p0 = _mm256_unpacklo_epi16(lo01, lo2), p1 = _mm256_unpackhi_epi16(lo01, lo2);
+        const __m256i p2 = _mm256_unpacklo_epi16(hi01, hi2), p3 = _mm256_unpackhi_epi16(hi01, hi2);
+        // Every store but the last one spills 8 bytes the next one overwrites.
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest),      pack(_mm256_permute2x128_si256(p0, p1, 0x20)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + 24), pack(_mm256_permute2x128_si256(p0, p1, 0x31)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + 48), pack(_mm256_permute2x128_si256(p2, p3, 0x20)));
+        const __m256i last = pack(_mm256_permute2x128_si256(p2, p3, 0x31));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + 72), _mm256_castsi256_si128(last));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dest + 88), _mm256_extracti128_si256(last, 1));
+    }
+
+    // 32 pixels of two rows, which share 16 chroma samples.
+    template <SbPixelConvertor::Layout layout, bool premultiplied>
+    static inline void ConvertBlock(const uint8_t* y0, const uint8_t* y1, const uint8_t* u, const uint8_t* v,
+                                    uint8_t* d0, uint8_t* d1, uint8_t alpha) {
+        const __m256i cu = _mm256_slli_epi16(_mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(u))), _mm256_set1_epi16(128)), 8);
+        const __m256i cv = _mm256_slli_epi16(_mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(v))), _mm256_set1_epi16(128)), 8);
+        // Chroma terms carry the rounding of the final shift.
+        const __m256i half = _mm256_set1_epi16(32);
+        const __m256i tr = _mm256_adds_epi16(half, _mm256_mulhrs_epi16(cv, _mm256_set1_epi16(sCoefRV)));
+        const __m256i tg = _mm256_subs_epi16(_mm256_subs_epi16(half, _mm256_mulhrs_epi16(cu, _mm256_set1_epi16(sCoefGU))),
+                                             _mm256_mulhrs_epi16(cv, _mm256_set1_epi16(sCoefGV)));
+        const __m256i tb = _mm256_adds_epi16(half, _mm256_mulhrs_epi16(cu, _mm256_set1_epi16(sCoefBU)));
+        __m256i ra, rb, ga, gb, ba, bb;
+        Spread(tr, ra, rb);
+        Spread(tg, ga, gb);
+        Spread(tb, ba, bb);
+        const __m256i alphas = _mm256_set1_epi16(alpha), opaque = _mm256_set1_epi8(static_cast<char>(alpha));
+
+        for (int row = 0; row != 2; ++row) {
+            const __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row ? y1 : y0));
+            const auto luma = [](__m128i bytes) {
+                const __m256i l = _mm256_slli_epi16(_mm256_sub_epi16(_mm256_cvtepu8_epi16(bytes), _mm256_set1_epi16(16)), 7);
+                return _mm256_mulhrs_epi16(l, _mm256_set1_epi16(sCoefY));
+            };
+            const __m256i ya = luma(_mm256_castsi256_si128(y)), yb = luma(_mm256_extracti128_si256(y, 1));
+            const __m256i r = Channel<premultiplied>(ya, yb, ra, rb, alphas);
+            const __m256i g = Channel<premultiplied>(ya, yb, ga, gb, alphas);
+            const __m256i b = Channel<premultiplied>(ya, yb, ba, bb, alphas);
+            uint8_t* dest = row ? d1 : d0;
+            if constexpr (layout == SbPixelConvertor::RGB)  { Store3(r, g, b, dest); }
+            if constexpr (layout == SbPixelConvertor::RGBA) { Store4(r, g, b, opaque, dest); }
+            if constexpr (layout == SbPixelConvertor::BGRA) { Store4(b, g, r, opaque, dest); }
+        }
+    }
+#else
+    // One pixel with exactly the arithmetic of the vector path.
+    template <SbPixelConvertor::Layout layout, bool premultiplied>
+    static inline void ConvertPixel(uint8_t y, uint8_t u, uint8_t v, uint8_t* dest, uint8_t alpha) {
+        const auto mulhrs = [](int a, int b) { return (a * b + 0x4000) >> 15; };
+        const int l = mulhrs((y - 16) << 7, sCoefY), cu = (u - 128) << 8, cv = (v - 128) << 8;
+        int c[3] = { l + 32 + mulhrs(cv, sCoefRV), l + 32 - mulhrs(cu, sCoefGU) - mulhrs(cv, sCoefGV), l + 32 + mulhrs(cu, sCoefBU) };
+        for (int& x : c) {
+            x = std::clamp(x >> 6, 0, 255);
+            if constexpr (premultiplied) { x = x * alpha + 128; x = (x + (x >> 8)) >> 8; }
+        }
+        if constexpr (layout == SbPixelConvertor::BGRA) { std::swap(c[0], c[2]); }
+        for (int i = 0; i != 3; ++i) { dest[i] = static_cast<uint8_t>(c[i]); }
+        if constexpr (layout != SbPixelConvertor::RGB) { dest[3] = alpha; }
+    }
+
+    template <SbPixelConvertor::Layout layout, bool premultiplied>
+    static inline void ConvertBlock(const uint8_t* y0, const uint8_t* y1, const uint8_t* u, const uint8_t* v,
+                                    uint8_t* d0, uint8_t* d1, uint8_t alpha) {
+        constexpr size_t bytes = layout == SbPixelConvertor::RGB ? 3 : 4;
+        for (size_t x = 0; x != 32; ++x) {
+            ConvertPixel<layout, premultiplied>(y0[x], u[x >> 1], v[x >> 1], d0 + x * bytes, alpha);
+            ConvertPixel<layout, premultiplied>(y1[x], u[x >> 1], v[x >> 1], d1 + x * bytes, alpha);
+        }
+    }
+#endif
+
+    template <SbPixelConvertor::Layout layout, bool premultiplied>
+    static void Convert(const SbOwlVisionCoreImage* img, uint8_t alpha, uint8_t* dest, size_t stride, size_t first, size_t count) {
+        constexpr size_t bytes = layout == SbPixelConvertor::RGB ? 3 : 4;
+        const size_t width    = img->width;
+        const size_t uv_width = width >> 1;
+        const uint8_t* u_plane = img->entity + width * img->height;
+        const uint8_t* v_plane = u_plane + ((width * img->height) >> 2);
+        for (size_t i = first >> 1; i < (first + count) >> 1; ++i, dest += stride << 1) {
+            const uint8_t* y0 = img->entity + (i << 1) * width;
+            const uint8_t* y1 = y0 + width;
+            const uint8_t* u  = u_plane + i * uv_width;
+            const uint8_t* v  = v_plane + i * uv_width;
+            size_t x = 0;
+            for (; x + 32 <= width; x += 32) {
+                ConvertBlock<layout, premultiplied>(y0 + x, y1 + x, u + (x >> 1), v + (x >> 1), dest + x * bytes, dest + stride + x * bytes, alpha);
             }
-            dest += img->width*3;
+            if (x == width) { continue; }
+            // Right edge through a padded copy, so it goes the same way as the rest of the row.
+            uint8_t ty0[32] = {}, ty1[32] = {}, tu[16], tv[16], td0[32 * 4], td1[32 * 4];
+            std::fill_n(tu, 16, uint8_t(128)); std::fill_n(tv, 16, uint8_t(128));
+            std::memcpy(ty0, y0 + x, width - x);
+            std::memcpy(ty1, y1 + x, width - x);
+            std::memcpy(tu, u + (x >> 1), (width - x) >> 1);
+            std::memcpy(tv, v + (x >> 1), (width - x) >> 1);
+            ConvertBlock<layout, premultiplied>(ty0, ty1, tu, tv, td0, td1, alpha);
+            std::memcpy(dest + x * bytes, td0, (width - x) * bytes);
+            std::memcpy(dest + stride + x * bytes, td1, (width - x) * bytes);
+        }
+    }
+
+    void SbPixelConvertor::operator()(uint8_t* dest, size_t stride, size_t first, size_t count) const {
+        if (!stride) { stride = img->width * PixelBytes(); }
+        // Colours times an alpha of 255 stay what they are.
+        const bool scale = premultiplied && alpha != 0xff;
+        switch (layout) {
+        case RGB:  scale ? Convert<RGB,  true>(img, alpha, dest, stride, first, count) : Convert<RGB,  false>(img, alpha, dest, stride, first, count); break;
+        case RGBA: scale ? Convert<RGBA, true>(img, alpha, dest, stride, first, count) : Convert<RGBA, false>(img, alpha, dest, stride, first, count); break;
+        case BGRA: scale ? Convert<BGRA, true>(img, alpha, dest, stride, first, count) : Convert<BGRA, false>(img, alpha, dest, stride, first, count); break;
         }
     }
+
+    void SbPixelConvertor::operator()(uint8_t* dest, size_t stride) const {
+        (*this)(dest, stride, 0, img->height);
+    }
+
+    void SbRGBA::operator()(uint8_t *dest) {
+        SbPixelConvertor{ img, SbPixelConvertor::RGBA }(dest);
+    }
+
+    void SbRGB::operator()(uint8_t* dest, size_t first, size_t count) {
+        SbPixelConvertor{ img, SbPixelConvertor::RGB }(dest, 0, first, count);
+    }
+
+    void SbRGB::operator()(uint8_t* dest) {
+        SbPixelConvertor{ img, SbPixelConvertor::RGB }(dest);
+    }
 }
@@ -5,9 +5,26 @@
 /// \date      1.22.2025
 /// \copyright © Steve Wang 2025
 ///
+#pragma once
 #include "OwlVision.hpp"
 
 namespace SubIT {
+    // YUV420 to packed 8 bit pixels in 16 bit fixed point, 32 pixels of two rows at a time with AVX2.
+    class SbPixelConvertor {
+    public:
+        enum Layout : uint8_t { RGB = 0, RGBA = 1, BGRA = 2 };
+
+        SbOwlVisionCoreImage* img;
+        Layout  layout        = RGBA;
+        uint8_t alpha         = 0xff;  // Alpha of RGBA and BGRA, the picture has none of its own.
+        bool    premultiplied = false; // Scale colours by alpha as well.
+
+        size_t PixelBytes() const { return layout == RGB ? 3 : 4; }
+        // Rows [first, first + count) into dest, both even. stride is the distance of two rows of dest, 0 for packed rows.
+        void operator()(uint8_t* dest, size_t stride, size_t first, size_t count) const;
+        void operator()(uint8_t* dest, size_t stride = 0) const;
+    };
+
     class SbRGBA {
     public:
         SbOwlVisionCoreImage *img;
@@ -18,5 +35,7 @@ namespace SubIT {
     public:
         SbOwlVisionCoreImage* img;
         void operator()(uint8_t* dest);
+        // Only rows [first, first + count) into dest, both even. Lets callers convert a band at a time.
+        void operator()(uint8_t* dest, size_t first, size_t count);
     };
 }
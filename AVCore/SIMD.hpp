@@ -7,7 +7,9 @@
 /// \copyright © HenryDu 2024. All right reserved.
 ///
 #pragma once
+#include <cstdint>
 #include <cstring>
+#include <cmath>
 #include <utility>
 #include <algorithm>
 
@@ -18,13 +20,14 @@
 #define SB_SIMD_X86_SSE4_1   5
 #define SB_SIMD_X86_SSE4_2   6
 #define SB_SIMD_X86_AVX      7
-#define SB_SIMD_X86_AVX512   8
+#define SB_SIMD_X86_AVX2     8
+#define SB_SIMD_X86_AVX512   9
 
 #define SB_SIMD_ARM_NEON   1
 
 // If you are using an x86 platform, set SB_SIMD_ARM to 0.
 // If you are using an arm platform, set SB_SIMD_X86 to 0.
-#define SB_SIMD_X86 SB_SIMD_X86_AVX
+#define SB_SIMD_X86 SB_SIMD_X86_AVX2
 #define SB_SIMD_ARM 0
 
 #if SB_SIMD_X86 >= SB_SIMD_X86_SSE1
@@ -88,6 +91,20 @@ namespace SubIT {
             *reinterpret_cast<__m128*>(a) = _mm_div_ps(*reinterpret_cast<__m128*>(a), *reinterpret_cast<const __m128*>(b));
 #else
             a[0] /= b[0]; a[1] /= b[1]; a[2] /= b[2]; a[3] /= b[3];
+#endif
+        }
+        static inline void MulA8(float* a, const float* b) {
+#if SB_SIMD_X86 >= SB_SIMD_X86_AVX
+            _mm256_storeu_ps(a, _mm256_mul_ps(_mm256_loadu_ps(a), _mm256_loadu_ps(b)));
+#else
+            MulA4(a, b); MulA4(a + 4, b + 4);
+#endif
+        }
+        static inline void DivA8(float* a, const float* b) {
+#if SB_SIMD_X86 >= SB_SIMD_X86_AVX
+            _mm256_storeu_ps(a, _mm256_div_ps(_mm256_loadu_ps(a), _mm256_loadu_ps(b)));
+#else
+            DivA4(a, b); DivA4(a + 4, b + 4);
 #endif
         }
         static inline auto Rotate2D(const float cr, const float sr, const float x0, const float y0) {
@@ -110,6 +127,148 @@ namespace SubIT {
             reinterpret_cast<int*>(f)[3] = static_cast<int>(f[3]);
 #endif
         }
+#if SB_SIMD_X86 >= SB_SIMD_X86_AVX
+        // Transpose 8 rows of 8 floats in registers, r[i] becomes column i.
+        static inline void Transpose8x8(__m256* r) {
+            const __m256 t0 = _mm256_unpacklo_ps(r[0], r[1]), t1 = _mm256_unpackhi_ps(r[0], r[1]);
+            const __m256 t2 = _mm256_unpacklo_ps(r[2], r[3]), t3 = _mm256_unpackhi_ps(r[2], r[3]);
+            const __m256 t4 = _mm256_unpacklo_ps(r[4], r[5]), t5 = _mm256_unpackhi_ps(r[4], r[5]);
+            const __m256 t6 = _mm256_unpacklo_ps(r[6], r[7]), t7 = _mm256_unpackhi_ps(r[6], r[7]);
+            const __m256 u0 = _mm256_shuffle_ps(t0, t2, 0x44), u1 = _mm256_shuffle_ps(t0, t2, 0xEE);
+            const __m256 u2 = _mm256_shuffle_ps(t1, t3, 0x44), u3 = _mm256_shuffle_ps(t1, t3, 0xEE);
+            const __m256 u4 = _mm256_shuffle_ps(t4, t6, 0x44), u5 = _mm256_shuffle_ps(t4, t6, 0xEE);
+            const __m256 u6 = _mm256_shuffle_ps(t5, t7, 0x44), u7 = _mm256_shuffle_ps(t5, t7, 0xEE);
+            r[0] = _mm256_permute2f128_ps(u0, u4, 0x20); r[4] = _mm256_permute2f128_ps(u0, u4, 0x31);
+            r[1] = _mm256_permute2f128_ps(u1, u5, 0x20); r[5] = _mm256_permute2f128_ps(u1, u5, 0x31);
+            r[2] = _mm256_permute2f128_ps(u2, u6, 0x20); r[6] = _mm256_permute2f128_ps(u2, u6, 0x31);
+            r[3] = _mm256_permute2f128_ps(u3, u7, 0x20); r[7] = _mm256_permute2f128_ps(u3, u7, 0x31);
+        }
+#endif
+#if SB_SIMD_X86 >= SB_SIMD_X86_AVX2
+        // Transpose two 8x8 int16 matrices at once, one in each 128 bit lane.
+        static inline void Transpose8x8x2(__m256i* r) {
+            const __m256i t0 = _mm256_unpacklo_epi16(r[0], r[1]), t1 = _mm256_unpackhi_epi16(r[0], r[1]);
+            const __m256i t2 = _mm256_unpacklo_epi16(r[2], r[3]), t3 = _mm256_unpackhi_epi16(r[2], r[3]);
+            const __m256i t4 = _mm256_unpacklo_epi16(r[4], r[5]), t5 = _mm256_unpackhi_epi16(r[4], r[5]);
+            const __m256i t6 = _mm256_unpacklo_epi16(r[6], r[7]), t7 = _mm256_unpackhi_epi16(r[6], r[7]);
+            const __m256i u0 = _mm256_unpacklo_epi32(t0, t2), u1 = _mm256_unpackhi_epi32(t0, t2);
+            const __m256i u2 = _mm256_unpacklo_epi32(t1, t3), u3 = _mm256_unpackhi_epi32(t1, t3);
+            const __m256i u4 = _mm256_unpacklo_epi32(t4, t6), u5 = _mm256_unpackhi_epi32(t4, t6);
+            const __m256i u6 = _mm256_unpacklo_epi32(t5, t7), u7 = _mm256_unpackhi_epi32(t5, t7);
+            r[0] = _mm256_unpacklo_epi64(u0, u4); r[1] = _mm256_unpackhi_epi64(u0, u4);
+            r[2] = _mm256_unpacklo_epi64(u1, u5); r[3] = _mm256_unpackhi_epi64(u1, u5);
+            r[4] = _mm256_unpacklo_epi64(u2, u6); r[5] = _mm256_unpackhi_epi64(u2, u6);
+            r[6] = _mm256_unpacklo_epi64(u3, u7); r[7] = _mm256_unpackhi_epi64(u3, u7);
+        }
+#endif
+        // 16 bytes to 16 fixed point samples and back, "Bias" means pixels are unsigned and centered at 128.
+        static inline void U8ToFixed16(const uint8_t* in, int16_t* out, int fractionBits) {
+#if SB_SIMD_X86 >= SB_SIMD_X86_AVX2
+            __m256i v = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in)));
+            v = _mm256_slli_epi16(_mm256_sub_epi16(v, _mm256_set1_epi16(128)), fractionBits);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), v);
+#else
+            for (int i = 0; i != 16; ++i) { out[i] = static_cast<int16_t>((in[i] - 128) * (1 << fractionBits)); }
+#endif
+        }
+        static inline void Fixed16ToU8(const int16_t* in, uint8_t* out, int fractionBits) {
+#if SB_SIMD_X86 >= SB_SIMD_X86_AVX2
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in));
+            v = _mm256_add_epi16(v, _mm256_set1_epi16(static_cast<int16_t>(1 << (fractionBits - 1))));
+            v = _mm256_add_epi16(_mm256_srai_epi16(v, fractionBits), _mm256_set1_epi16(128));
+            v = _mm256_permute4x64_epi64(_mm256_packus_epi16(v, v), 0x08);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm256_castsi256_si128(v));
+#else
+            for (int i = 0; i != 16; ++i) {
+                const int16_t r = static_cast<int16_t>(in[i] + (1 << (fractionBits - 1)));
+                out[i] = static_cast<uint8_t>(std::clamp((r >> fractionBits) + 128, 0, 255));
+            }
+#endif
+        }
+        static inline void I8ToI16x16(const int8_t* in, int16_t* out) {
+#if SB_SIMD_X86 >= SB_SIMD_X86_AVX2
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in))));
+#else
+            for (int i = 0; i != 16; ++i) { out[i] = in[i]; }
+#endif
+        }
+        static inline void I16ToI8x16(const int16_t* in, int8_t* out) { // With saturation.
+#if SB_SIMD_X86 >= SB_SIMD_X86_AVX2
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in));
+            v = _mm256_permute4x64_epi64(_mm256_packs_epi16(v, v), 0x08);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm256_castsi256_si128(v));
+#else
+            for (int i = 0; i != 16; ++i) { out[i] = static_cast<int8_t>(std::clamp<int>(in[i], -128, 127)); }
+#endif
+        }
+        // 8 samples between bytes and floats, the same conversions as the float pipeline stages make with F2I4.
+        // Floats are rounded to nearest and only the low byte is kept, "Bias" means pixels are centered at 128.
+        static inline void U8ToF8Bias(const uint8_t* in, float* out) {
+#if SB_SIMD_X86 >= SB_SIMD_X86_AVX2
+            const __m256 v = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(in))));
+            _mm256_storeu_ps(out, _mm256_sub_ps(v, _mm256_set1_ps(128.F)));
+#else
+            for (int i = 0; i != 8; ++i) { out[i] = static_cast<float>(in[i]) - 128.F; }
+#endif
+        }
+        static inline void I8ToF8(const int8_t* in, float* out) {
+#if SB_SIMD_X86 >= SB_SIMD_X86_AVX2
+            _mm256_storeu_ps(out, _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(in)))));
+#else
+            for (int i = 0; i != 8; ++i) { out[i] = static_cast<float>(in[i]); }
+#endif
+        }
+        static inline void F8ToI8(const float* in, int8_t* out) {
+#if SB_SIMD_X86 >= SB_SIMD_X86_AVX2
+            StoreLowBytes8(_mm256_cvtps_epi32(_mm256_loadu_ps(in)), out);
+#else
+            alignas(16) float f[8];
+            std::memcpy(f, in, sizeof(f));
+            F2I4(f); F2I4(f + 4);
+            for (int i = 0; i != 8; ++i) { out[i] = static_cast<int8_t>(reinterpret_cast<int*>(f)[i]); }
+#endif
+        }
+        static inline void F8ToU8Bias(const float* in, uint8_t* out) {
+#if SB_SIMD_X86 >= SB_SIMD_X86_AVX2
+            StoreLowBytes8(_mm256_cvtps_epi32(_mm256_add_ps(_mm256_loadu_ps(in), _mm256_set1_ps(128.F))), out);
+#else
+            alignas(16) float f[8];
+            for (int i = 0; i != 8; ++i) { f[i] = in[i] + 128.F; }
+            F2I4(f); F2I4(f + 4);
+            for (int i = 0; i != 8; ++i) { out[i] = static_cast<uint8_t>(reinterpret_cast<int*>(f)[i]); }
+#endif
+        }
+        // Like F8ToU8Bias, but halves round up and results saturate to 0..255 instead of wrapping.
+        static inline void F8ToU8BiasSaturate(const float* in, uint8_t* out) {
+#if SB_SIMD_X86 >= SB_SIMD_X86_AVX2
+            const __m256i v = _mm256_cvttps_epi32(_mm256_floor_ps(_mm256_add_ps(_mm256_loadu_ps(in), _mm256_set1_ps(128.5F))));
+            StoreLowBytes8(_mm256_min_epi32(_mm256_max_epi32(v, _mm256_setzero_si256()), _mm256_set1_epi32(255)), out);
+#else
+            for (int i = 0; i != 8; ++i) { out[i] = static_cast<uint8_t>(std::clamp(static_cast<int>(std::floor(in[i] + 128.5F)), 0, 255)); }
+#endif
+        }
+        // 8 rows of 8 floats, in[i * 8 + j] goes to out[j * 8 + i].
+        static inline void TransposeF8x8(const float* in, float* out) {
+#if SB_SIMD_X86 >= SB_SIMD_X86_AVX
+            __m256 r[8];
+            for (int i = 0; i != 8; ++i) { r[i] = _mm256_loadu_ps(in + i * 8); }
+            Transpose8x8(r);
+            for (int i = 0; i != 8; ++i) { _mm256_storeu_ps(out + i * 8, r[i]); }
+#else
+            for (int i = 0; i != 8; ++i) {
+                for (int j = 0; j != 8; ++j) { out[j * 8 + i] = in[i * 8 + j]; }
+            }
+#endif
+        }
+#if SB_SIMD_X86 >= SB_SIMD_X86_AVX2
+        // Low byte of every 32 bit lane, like a cast to a byte.
+        static inline void StoreLowBytes8(__m256i v, void* out) {
+            const __m256i lows = _mm256_shuffle_epi8(v, _mm256_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                                                          0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1));
+            const __m256i both = _mm256_permutevar8x32_epi32(lows, _mm256_setr_epi32(0, 4, 1, 1, 1, 1, 1, 1));
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(out), _mm256_castsi256_si128(both));
+        }
+#endif
         static inline void yuv2rgba(float y, float u, float v, unsigned char *dest) {
 #if SB_SIMD_X86 >= SB_SIMD_X86_SSE3
             __m128  t  = _mm_set_ps(y, u, v, 255.F);
@@ -0,0 +1,134 @@
+///
+/// \file      ThreadPool.cpp
+/// \brief     Implementation of ThreadPool.hpp
+/// \author    HenryDu
+/// \date      10.16.2026
+/// \copyright © HenryDu 2026. All right reserved.
+///
+
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <exception>
+
+namespace SubIT {
+
+    // Pool and queue of the worker running on this thread, if it is one.
+    static thread_local SbThreadPool* sWorkerPool  = nullptr;
+    static thread_local size_t        sWorkerIndex = 0;
+    static thread_local SbThreadPool* sCurrentPool = nullptr;
+
+    SbThreadPool::SbThreadPool(size_t threads) {
+        for (size_t i = 0; i != threads; ++i) { queues.push_back(std::make_unique<Queue>()); }
+        for (size_t i = 0; i != threads; ++i) { workers.emplace_back(&SbThreadPool::Work, this, i); }
+    }
+
+    SbThreadPool::~SbThreadPool() {
+        {
+            std::lock_guard lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& worker : workers) { worker.join(); }
+    }
+
+    void SbThreadPool::Submit(Task task) {
+        if (workers.empty()) { task(); return; }
+        const size_t target = (sWorkerPool == this) ? sWorkerIndex : dealt++ % queues.size();
+        {
+            std::lock_guard lock(queues[target]->mutex);
+            queues[target]->tasks.push_back(std::move(task));
+        }
+        {
+            std::lock_guard lock(mutex);
+            ++pending;
+        }
+        wake.notify_one();
+    }
+
+    bool SbThreadPool::TryRun(size_t self) {
+        Task task;
+        for (size_t k = 0; k != queues.size() && !task; ++k) {
+            Queue& queue = *queues[(self + k) % queues.size()];
+            std::lock_guard lock(queue.mutex);
+            if (queue.tasks.empty()) { continue; }
+            // Own tasks newest first while they are still in cache, stolen ones oldest first since they're the biggest.
+            if (k == 0) { task = std::move(queue.tasks.back());  queue.tasks.pop_back(); }
+            else        { task = std::move(queue.tasks.front()); queue.tasks.pop_front(); }
+        }
+        if (!task) { return false; }
+        --pending;
+        task();
+        return true;
+    }
+
+    void SbThreadPool::Work(size_t self) {
+        sWorkerPool  = this;
+        sWorkerIndex = self;
+        while (true) {
+            if (TryRun(self)) { continue; }
+            std::unique_lock lock(mutex);
+            wake.wait(lock, [this] { return stopping || pending != 0; });
+            if (stopping && pending == 0) { return; }
+        }
+    }
+
+    void SbThreadPool::ParallelFor(size_t count, const std::function<void(size_t)>& fn) {
+        if (count == 0) { return; }
+        if (count == 1 || workers.empty()) {
+            for (size_t i = 0; i != count; ++i) { fn(i); }
+            return;
+        }
+        // Helpers may start after this call returned, so whatever they touch lives as long as the last of them.
+        struct Group {
+            std::atomic<size_t>                  next = 0, done = 0;
+            size_t                               count = 0;
+            const std::function<void(size_t)>*   fn = nullptr;
+            std::exception_ptr                   error;
+            std::mutex                           mutex;
+            std::condition_variable              finished;
+        };
+        const auto group = std::make_shared<Group>();
+        group->count = count;
+        group->fn    = &fn;
+        const auto run = [group] {
+            size_t ran = 0;
+            for (size_t i; (i = group->next++) < group->count; ++ran) {
+                try { (*group->fn)(i); }
+                catch (...) {
+                    std::lock_guard lock(group->mutex);
+                    if (!group->error) { group->error = std::current_exception(); }
+                }
+            }
+            if (ran && (group->done += ran) == group->count) {
+                std::lock_guard lock(group->mutex);
+                group->finished.notify_all();
+            }
+        };
+        for (size_t i = 0, helpers = std::min(count - 1, workers.size()); i != helpers; ++i) { Submit(run); }
+        run();
+        std::unique_lock lock(group->mutex);
+        group->finished.wait(lock, [&] { return group->done == group->count; });
+        if (group->error) { std::rethrow_exception(group->error); }
+    }
+
+    SbThreadPool& SbThreadPool::Default() {
+        static SbThreadPool pool(std::max(std::thread::hardware_concurrency(), 2u) - 1);
+        return pool;
+    }
+
+    SbThreadPool& SbThreadPool::Current() {
+        if (sCurrentPool) { return *sCurrentPool; }
+        if (sWorkerPool)  { return *sWorkerPool; }
+        return Default();
+    }
+
+    SbThreadPool::Scope::Scope(SbThreadPool* pool) : previous(sCurrentPool) {
+        if (pool) { sCurrentPool = pool; }
+    }
+
+    SbThreadPool::Scope::~Scope() {
+        sCurrentPool = previous;
+    }
+
+}
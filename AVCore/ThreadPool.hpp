@@ -0,0 +1,78 @@
+///
+/// \file      ThreadPool.hpp
+/// \brief     Persistent work stealing thread pool shared by all SubAV codecs.
+/// \details   Workers live as long as the pool, so decoding many small images doesn't create a thread per call.
+/// \author    HenryDu
+/// \date      10.16.2026
+/// \copyright © HenryDu 2026. All right reserved.
+///
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace SubIT {
+
+    // Every worker has its own queue, takes its newest task first and steals the oldest one of another worker when
+    // it runs dry. Tasks submitted by a worker go to its own queue, others are dealt round robin.
+    class SbThreadPool {
+    public:
+        using Task = std::function<void()>;
+
+        // threads workers, a thread waiting in ParallelFor works on its range too so 0 is allowed.
+        explicit SbThreadPool(size_t threads);
+        // Runs what is still queued, then joins the workers.
+        ~SbThreadPool();
+        SbThreadPool(const SbThreadPool&) = delete;
+        SbThreadPool& operator=(const SbThreadPool&) = delete;
+
+        size_t Size() const { return workers.size(); }
+        // Run task on some worker, or right here if there are none. Tasks must not throw.
+        void Submit(Task task);
+        // Call fn(i) for every i in [0, count) and return once all of them are done. Indices are handed out one at a
+        // time so uneven ones balance, the first exception thrown by fn is rethrown here after the others finish.
+        void ParallelFor(size_t count, const std::function<void(size_t)>& fn);
+
+        // One worker less than the hardware has (but at least one), the calling thread is the last one.
+        static SbThreadPool& Default();
+        // Pool of the innermost Scope on this thread, the pool of this worker, or Default().
+        static SbThreadPool& Current();
+
+        // Make pool current on this thread till the scope ends, a null pool leaves it as it is.
+        class Scope {
+        public:
+            explicit Scope(SbThreadPool* pool);
+            ~Scope();
+            Scope(const Scope&) = delete;
+            Scope& operator=(const Scope&) = delete;
+        private:
+            SbThreadPool* previous;
+        };
+
+    private:
+        struct Queue {
+            std::mutex       mutex;
+            std::deque<Task> tasks;
+        };
+
+        // Pop a task of worker self or steal one, and run it.
+        bool TryRun(size_t self);
+        void Work(size_t self);
+
+        std::vector<std::unique_ptr<Queue>> queues;
+        std::vector<std::thread>            workers;
+        std::mutex                          mutex;   // Sleeping workers wait on it, raised pending and stopping are set under it.
+        std::condition_variable             wake;
+        std::atomic<size_t>                 pending  = 0; // Queued tasks nobody has taken yet.
+        std::atomic<size_t>                 dealt    = 0; // Round robin of tasks submitted from outside.
+        bool                                stopping = false;
+    };
+
+}
@@ -0,0 +1,628 @@
+///
+/// \file      Benchmark.cpp
+/// \brief     Implementation of Benchmark.hpp
+/// \author    HenryDu
+/// \date      10.16.2026
+/// \copyright © HenryDu 2026. All right reserved.
+///
+
+#include "../AVCore/common.hpp"
+#include "../AVCore/DCT.hpp"
+#include "../AVCore/OwlVision.hpp"
+#include "../AVCore/OwlVisionAsync.hpp"
+#include "../AVCore/MaxFOG.hpp"
+#include "../AVCore/IKP.hpp"
+#include "../AVCore/MemoryStream.hpp"
+#include "../AVCore/RGBA.hpp"
+#include "../AVCore/SIMD.hpp"
+
+#include "Benchmark.hpp"
+
+#include <chrono>
+#include <numeric>
+#include <random>
+#include <sstream>
+
+namespace SubIT {
+
+    template <class Fn>
+    double SbAVBenchmark::Measure(std::string_view name, double units, std::string_view unitName, Fn&& fn) {
+        // Warm up once, then take the best of several rounds to get rid of noise.
+        fn();
+        double best = 0.0;
+        for (int round = 0; round != 5; ++round) {
+            const auto start = std::chrono::high_resolution_clock::now();
+            fn();
+            const auto stop  = std::chrono::high_resolution_clock::now();
+            best = std::max(best, units / std::chrono::duration<double>(stop - start).count());
+        }
+        std::cout << std::format("{:<40s} {:>14.2f} {:s}/s\n", name, best, unitName);
+        return best;
+    }
+
+    void SbAVBenchmark::Run(std::string_view suite, std::string_view input) {
+        if (suite == "dct8x8")   { DCT8x8(); return; }
+        if (suite == "dct")      { DCTSizes(); return; }
+        if (suite == "pipeline") { Pipeline(input); return; }
+        if (suite == "entropy")  { Entropy(input); return; }
+        if (suite == "fused")    { Fused(); return; }
+        if (suite == "threads")  { Threads(); return; }
+        if (suite == "colour")   { Colour(); return; }
+        std::cout << "Error, unknown benchmark suite." << std::endl;
+    }
+
+    void SbAVBenchmark::DCT8x8() {
+        constexpr size_t width = 1024, height = 1024, blocks = (width >> 3) * (height >> 3);
+        std::vector<float> plane(width * height);
+        std::mt19937 rng(2024);
+        std::uniform_real_distribution<float> dist(-128.F, 127.F);
+        std::generate(plane.begin(), plane.end(), [&] { return dist(rng); });
+
+        // The path every block took before Transform8x8 was vectorized: 16 scalar 1D transforms.
+        const auto scalar = [&]<bool Dir>() {
+            for (size_t y = 0; y != height; y += 8) {
+                for (size_t x = 0; x != width; x += 8) {
+                    float* src = plane.data() + y * width + x;
+                    for (ptrdiff_t i = 0; i != 8; ++i) { SbDCT row(src + i * width, 1); row.Transform8<Dir>(); }
+                    for (ptrdiff_t i = 0; i != 8; ++i) { SbDCT col(src + i, width); col.Transform8<Dir>(); }
+                }
+            }
+        };
+        const auto single = [&]<bool Dir>() {
+            for (size_t y = 0; y != height; y += 8) {
+                for (size_t x = 0; x != width; x += 8) {
+                    SbDCT2(plane.data() + y * width + x, width).Transform8x8<Dir>();
+                }
+            }
+        };
+        const auto batched = [&]<bool Dir>() {
+            for (size_t y = 0; y != height; y += 8) {
+                SbDCT2(plane.data() + y * width, width).Transform8x8N<Dir>(width >> 3);
+            }
+        };
+
+        Measure("scalar 8x8 forward",  blocks, "blocks", [&] { scalar .template operator()<SbDCT::dirForward>(); });
+        Measure("scalar 8x8 inverse",  blocks, "blocks", [&] { scalar .template operator()<SbDCT::dirInverse>(); });
+        Measure("simd 8x8 forward",    blocks, "blocks", [&] { single .template operator()<SbDCT::dirForward>(); });
+        Measure("simd 8x8 inverse",    blocks, "blocks", [&] { single .template operator()<SbDCT::dirInverse>(); });
+        Measure("simd 8x8 row forward", blocks, "blocks", [&] { batched.template operator()<SbDCT::dirForward>(); });
+        Measure("simd 8x8 row inverse", blocks, "blocks", [&] { batched.template operator()<SbDCT::dirInverse>(); });
+    }
+
+
+    void SbAVBenchmark::DCTSizes() {
+        constexpr size_t width = 1024, height = 1024;
+        std::vector<float> plane(width * height);
+        std::mt19937 rng(2024);
+        std::uniform_real_distribution<float> dist(-128.F, 127.F);
+        std::generate(plane.begin(), plane.end(), [&] { return dist(rng); });
+
+        const auto run = [&]<size_t N, bool Dir>() {
+            for (size_t y = 0; y != height; y += N) {
+                for (size_t x = 0; x != width; x += N) {
+                    SbDCT2 transformer(plane.data() + y * width + x, width);
+                    if constexpr (N == 4)  { transformer.Transform4x4<Dir>(); }
+                    if constexpr (N == 8)  { transformer.Transform8x8<Dir>(); }
+                    if constexpr (N == 16) { transformer.Transform16x16<Dir>(); }
+                    if constexpr (N == 32) { transformer.Transform32x32<Dir>(); }
+                }
+            }
+        };
+        // The 1D kernels alone, the way SbDCT2 used them before the 2D paths were vectorized.
+        const auto rows = [&]<size_t N>() {
+            for (size_t i = 0; i != height; ++i) {
+                for (size_t x = 0; x != width; x += N) {
+                    SbDCT row(plane.data() + i * width + x);
+                    if constexpr (N == 8)  { row.Transform8<SbDCT::dirForward>(); }
+                    if constexpr (N == 16) { row.Transform16<SbDCT::dirForward>(); }
+                    if constexpr (N == 32) { row.Transform32<SbDCT::dirForward>(); }
+                }
+            }
+        };
+
+        const double coefficients = static_cast<double>(width * height);
+        Measure("4x4 forward",     coefficients, "coefficients", [&] { run.template operator()<4,  SbDCT::dirForward>(); });
+        Measure("4x4 inverse",     coefficients, "coefficients", [&] { run.template operator()<4,  SbDCT::dirInverse>(); });
+        Measure("8x8 forward",     coefficients, "coefficients", [&] { run.template operator()<8,  SbDCT::dirForward>(); });
+        Measure("8x8 inverse",     coefficients, "coefficients", [&] { run.template operator()<8,  SbDCT::dirInverse>(); });
+        Measure("16x16 forward",   coefficients, "coefficients", [&] { run.template operator()<16, SbDCT::dirForward>(); });
+        Measure("16x16 inverse",   coefficients, "coefficients", [&] { run.template operator()<16, SbDCT::dirInverse>(); });
+        Measure("32x32 forward",   coefficients, "coefficients", [&] { run.template operator()<32, SbDCT::dirForward>(); });
+        Measure("32x32 inverse",   coefficients, "coefficients", [&] { run.template operator()<32, SbDCT::dirInverse>(); });
+        Measure("1D 8 scalar rows",  coefficients, "coefficients", [&] { rows.template operator()<8>(); });
+        Measure("1D 16 scalar rows", coefficients, "coefficients", [&] { rows.template operator()<16>(); });
+        Measure("1D 32 scalar rows", coefficients, "coefficients", [&] { rows.template operator()<32>(); });
+    }
+
+    void SbAVBenchmark::Pipeline(std::string_view ovc) {
+        std::ifstream file(ovc.data(), std::ios::binary);
+        const std::string bytes{ std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+
+        for (const bool fixedPoint : { false, true }) {
+            SbOwlVisionCoreImage image;
+            SbOwlVisionContainer container{ &image };
+            container.fixedPoint = fixedPoint;
+
+            const auto decode = [&] {
+                std::istringstream in(bytes, std::ios::binary);
+                container(&in, ::operator new);
+            };
+            // Decode once to know the size, every later decode just replaces it.
+            decode();
+            const double pixels = static_cast<double>(image.width * image.height);
+            image.Deallocate(::operator delete);
+            Measure(fixedPoint ? "fixed decode" : "float decode", pixels, "pixels", [&] { decode(); image.Deallocate(::operator delete); });
+            // Same bytes without the istream copy, entropy decoders read them in place.
+            Measure(fixedPoint ? "fixed memory decode" : "float memory decode", pixels, "pixels", [&] {
+                container(std::as_bytes(std::span(bytes)), ::operator new);
+                image.Deallocate(::operator delete);
+            });
+
+            // Encoder needs a seekable stream and destroys its input, so keep a copy around.
+            decode();
+            std::vector<uint8_t> raw(image.entity, image.entity + image.size());
+            Measure(fixedPoint ? "fixed encode" : "float encode", pixels, "pixels", [&] {
+                std::stringstream out(std::string(bytes.size() * 2, '\0'), std::ios::in | std::ios::out | std::ios::binary);
+                std::memcpy(image.entity, raw.data(), raw.size());
+                container(static_cast<std::ostream*>(&out), ::operator new);
+            });
+            image.Deallocate(::operator delete);
+        }
+
+        // Thumbnails, pixels of the full picture per second so they compare with a full decode.
+        for (const uint8_t scale : { 1, 2, 3 }) {
+            SbOwlVisionCoreImage image;
+            SbOwlVisionContainer container{ &image };
+            container.scale = scale;
+            std::istringstream in(bytes, std::ios::binary);
+            container(&in, ::operator new);
+            const double pixels = static_cast<double>(image.width * image.height) * static_cast<double>(size_t(1) << (scale << 1));
+            image.Deallocate(::operator delete);
+            Measure(std::format("1/{} scaled decode", 1 << scale), pixels, "pixels", [&] {
+                std::istringstream scaledIn(bytes, std::ios::binary);
+                container(&scaledIn, ::operator new);
+                image.Deallocate(::operator delete);
+            });
+        }
+
+        // Same picture written again with a block size map, to see what VarDCT does to decoding.
+        SbOwlVisionCoreImage image;
+        SbOwlVisionContainer container{ &image };
+        std::istringstream in(bytes, std::ios::binary);
+        container(&in, ::operator new);
+        const double pixels = static_cast<double>(image.width * image.height);
+        container.features  = SbOwlVisionContainer::VarDCT;
+        std::stringstream out(std::string(bytes.size() * 2, '\0'), std::ios::in | std::ios::out | std::ios::binary);
+        container(static_cast<std::ostream*>(&out), ::operator new);
+        image.Deallocate(::operator delete);
+        const std::string varBytes = out.str();
+        Measure("vardct decode", pixels, "pixels", [&] {
+            std::istringstream varIn(varBytes, std::ios::binary);
+            container(&varIn, ::operator new);
+            image.Deallocate(::operator delete);
+        });
+
+        // Progressive copy, how many bytes every scan needs and how long each refinement takes.
+        std::istringstream progressiveIn(bytes, std::ios::binary);
+        container(&progressiveIn, ::operator new);
+        container.features = SbOwlVisionContainer::Zigzag | SbOwlVisionContainer::ZeroRun | SbOwlVisionContainer::PlaneTrees | SbOwlVisionContainer::Progressive;
+        std::stringstream progressiveOut(std::ios::in | std::ios::out | std::ios::binary);
+        container(static_cast<std::ostream*>(&progressiveOut), ::operator new);
+        image.Deallocate(::operator delete);
+        const std::string progressiveBytes = progressiveOut.str();
+        std::vector<size_t> scanEnds;
+        {
+            SbOwlVisionCoreImage      preview;
+            SbOwlVisionContainer      previewContainer{ &preview };
+            SbOwlVisionProgressiveReader reader(&previewContainer, ::operator new);
+            for (size_t i = 0; i != progressiveBytes.size(); ++i) {
+                if (reader.Feed(progressiveBytes.data() + i, 1)) { scanEnds.push_back(i + 1); }
+            }
+            preview.Deallocate(::operator delete);
+        }
+        for (size_t s = 0; s != scanEnds.size(); ++s) {
+            std::cout << std::format("{:<40s} {:>14d} bytes ({:.1f}%)\n", std::format("progressive scan {}", s), scanEnds[s],
+                                     100.0 * static_cast<double>(scanEnds[s]) / static_cast<double>(progressiveBytes.size()));
+        }
+        Measure("progressive first scan", pixels, "pixels", [&] {
+            SbOwlVisionCoreImage      preview;
+            SbOwlVisionContainer      previewContainer{ &preview };
+            SbOwlVisionProgressiveReader reader(&previewContainer, ::operator new);
+            reader.Feed(progressiveBytes.data(), scanEnds.front());
+            preview.Deallocate(::operator delete);
+        });
+        Measure("progressive all scans", pixels, "pixels", [&] {
+            SbOwlVisionCoreImage      preview;
+            SbOwlVisionContainer      previewContainer{ &preview };
+            SbOwlVisionProgressiveReader reader(&previewContainer, ::operator new);
+            size_t fed = 0;
+            for (const size_t end : scanEnds) { reader.Feed(progressiveBytes.data() + fed, end - fed); fed = end; }
+            preview.Deallocate(::operator delete);
+        });
+
+        // Tiled copy, one 256x256 region against the whole picture.
+        std::istringstream tiledIn(bytes, std::ios::binary);
+        container(&tiledIn, ::operator new);
+        container.features = SbOwlVisionContainer::Zigzag | SbOwlVisionContainer::ZeroRun | SbOwlVisionContainer::Tiled;
+        std::stringstream tiledOut(std::ios::in | std::ios::out | std::ios::binary);
+        container(static_cast<std::ostream*>(&tiledOut), ::operator new);
+        const size_t regionX = (image.width / 2) & ~size_t(15), regionY = (image.height / 2) & ~size_t(15);
+        const size_t regionW = std::min<size_t>(256, image.width - regionX), regionH = std::min<size_t>(256, image.height - regionY);
+        image.Deallocate(::operator delete);
+        const std::string tiledBytes = tiledOut.str();
+        Measure("tiled decode", pixels, "pixels", [&] {
+            std::istringstream tiled(tiledBytes, std::ios::binary);
+            container(&tiled, ::operator new);
+            image.Deallocate(::operator delete);
+        });
+        Measure("tiled region decode", static_cast<double>(regionW * regionH), "pixels", [&] {
+            std::istringstream tiled(tiledBytes, std::ios::binary);
+            container.DecodeRegion(&tiled, ::operator new, regionX, regionY, regionW, regionH);
+            image.Deallocate(::operator delete);
+        });
+
+        // Strip copy, one strip in memory at a time on both sides.
+        std::istringstream stripsIn(bytes, std::ios::binary);
+        container(&stripsIn, ::operator new);
+        container.features = SbOwlVisionContainer::Zigzag | SbOwlVisionContainer::ZeroRun | SbOwlVisionContainer::PlaneTrees | SbOwlVisionContainer::Strips;
+        const std::vector<uint8_t> stripsRaw(image.entity, image.entity + image.size());
+        std::string stripBytes;
+        Measure("strips encode", pixels, "pixels", [&] {
+            std::stringstream stripsOut(std::ios::in | std::ios::out | std::ios::binary);
+            SbOwlVisionStripWriter writer(&container, &stripsOut);
+            writer.Write([&](uint8_t* y, uint8_t* cb, uint8_t* cr, size_t row, size_t rows) {
+                const size_t wh = image.width * image.height;
+                std::memcpy(y,  stripsRaw.data() + row * image.width, rows * image.width);
+                std::memcpy(cb, stripsRaw.data() + wh + (row >> 1) * (image.width >> 1), (rows * image.width) >> 2);
+                std::memcpy(cr, stripsRaw.data() + wh + (wh >> 2) + (row >> 1) * (image.width >> 1), (rows * image.width) >> 2);
+            });
+            stripBytes = stripsOut.str();
+        });
+        image.Deallocate(::operator delete);
+        Measure("strips decode", pixels, "pixels", [&] {
+            std::istringstream strips(stripBytes, std::ios::binary);
+            SbOwlVisionStripReader reader(&container, &strips);
+            while (reader.Next()) {}
+        });
+
+        // Small textures, where starting threads per image used to cost more than decoding it.
+        std::istringstream textureIn(bytes, std::ios::binary);
+        container.DecodeRegion(&textureIn, ::operator new, 0, 0, 64, 64);
+        container.features = SbOwlVisionContainer::Zigzag | SbOwlVisionContainer::ZeroRun;
+        std::stringstream textureOut(std::ios::in | std::ios::out | std::ios::binary);
+        container(static_cast<std::ostream*>(&textureOut), ::operator new);
+        image.Deallocate(::operator delete);
+        const std::string textureBytes = textureOut.str();
+        Measure("64x64 texture decode", 256, "textures", [&] {
+            for (size_t i = 0; i != 256; ++i) {
+                SbMemoryStream texture(std::as_bytes(std::span(textureBytes)));
+                container(&texture, ::operator new);
+                image.Deallocate(::operator delete);
+            }
+        });
+        // Same textures all in flight at once from this thread, which only waits for the last one.
+        const SbOwlVisionAsyncDecoder asyncDecoder;
+        Measure("64x64 async texture decode", 256, "textures", [&] {
+            std::atomic<size_t> left = 256;
+            SbOwlVisionDecodeRequest request;
+            request.bytes = std::as_bytes(std::span(textureBytes));
+            for (size_t i = 0; i != 256; ++i) {
+                asyncDecoder.Decode(request, [&left](std::exception_ptr, SbOwlVisionDecoded) {
+                    if (--left == 0) { left.notify_one(); }
+                });
+            }
+            for (size_t seen = left.load(); seen != 0; seen = left.load()) { left.wait(seen); }
+        });
+    }
+
+    void SbAVBenchmark::Entropy(std::string_view ovc) {
+        SbOwlVisionCoreImage image;
+        SbOwlVisionContainer container{ &image };
+        std::ifstream file(ovc.data(), std::ios::binary);
+        container(&file, ::operator new);
+        const std::vector<uint8_t> raw(image.entity, image.entity + image.size());
+        // Bit buffer of the entropy coders alone, as big as shadow used to be so nothing is ever spilled.
+        std::vector<uint8_t> bitBuffer(image.size() * sizeof(float));
+        const double pixels = static_cast<double>(image.width * image.height), megabytes = static_cast<double>(image.size()) / 1e6;
+
+        const std::pair<const char*, uint32_t> modes[] = {
+            { "plain",           0 },
+            { "zigzag",          SbOwlVisionContainer::Zigzag },
+            { "zero run",        SbOwlVisionContainer::ZeroRun },
+            { "zigzag zero run", SbOwlVisionContainer::Zigzag | SbOwlVisionContainer::ZeroRun },
+            { "restart",         SbOwlVisionContainer::Zigzag | SbOwlVisionContainer::ZeroRun | SbOwlVisionContainer::Restart },
+            { "plane trees",     SbOwlVisionContainer::Zigzag | SbOwlVisionContainer::ZeroRun | SbOwlVisionContainer::PlaneTrees },
+            { "band trees",      SbOwlVisionContainer::Zigzag | SbOwlVisionContainer::ZeroRun | SbOwlVisionContainer::BandTrees },
+            { "plane band trees",SbOwlVisionContainer::Zigzag | SbOwlVisionContainer::ZeroRun | SbOwlVisionContainer::PlaneTrees | SbOwlVisionContainer::BandTrees },
+            { "chunked",         SbOwlVisionContainer::Zigzag | SbOwlVisionContainer::ZeroRun | SbOwlVisionContainer::PlaneTrees | SbOwlVisionContainer::BandTrees | SbOwlVisionContainer::Chunked },
+            { "zigzag rans",     SbOwlVisionContainer::Zigzag | SbOwlVisionContainer::RANS },
+            { "plane band rans", SbOwlVisionContainer::Zigzag | SbOwlVisionContainer::RANS | SbOwlVisionContainer::PlaneTrees | SbOwlVisionContainer::BandTrees },
+        };
+        const char* const decoderNames[] = { "ikp", "lut", "static" };
+        // Decoded coefficients of the first mode of each layout, plain and zigzag.
+        std::vector<uint8_t> references[2];
+        for (const auto& [name, features] : modes) {
+            const uint32_t fogModes = SbOwlVisionContainer::MaxFOGModes(features);
+            // Parts of entity that are one entropy stream each.
+            std::vector<std::pair<size_t, size_t>> streams{ { 0, image.size() } };
+            if (features & SbOwlVisionContainer::PlaneTrees) {
+                streams.clear();
+                for (uint8_t p = 0; p != 3; ++p) {
+                    SbOwlVisionCoreImage::ShadowOperationPipelineInfo pi;
+                    image.InitShadowOperationPipelineInfo(static_cast<SbOwlVisionCoreImage::PlaneType>(p), &pi);
+                    streams.emplace_back(pi.offset, pi.size);
+                }
+            }
+            std::memcpy(image.entity, raw.data(), raw.size());
+            container.features = features;
+            std::stringstream out(std::ios::in | std::ios::out | std::ios::binary);
+            container(static_cast<std::ostream*>(&out), ::operator new);
+            const std::string bytes = out.str();
+            std::cout << std::format("{:<40s} {:>14d} bytes\n", name, bytes.size());
+
+            // Entropy streams start right after the header, none of these modes has feature data.
+            const bool   rans         = features & SbOwlVisionContainer::RANS;
+            const size_t streamOffset = features ? 28 : 24;
+            const auto decodeStreams = [&](SbCodecMaxFOG::Decoder decoder) {
+                std::istringstream in(bytes, std::ios::binary);
+                in.seekg(static_cast<std::streamoff>(streamOffset));
+                for (const auto& [offset, size] : streams) {
+                    if (rans) { SbCodecRANS::DecodeBytes(image.entity + offset, &in, bitBuffer.data()); continue; }
+                    SbCodecMaxFOG::DecodeBits(image.entity + offset, SbCodecMaxFOG::GetEncodedBits(&in), &in, bitBuffer.data(),
+                                              fogModes, decoder);
+                }
+            };
+            // Coefficient bytes per second, the same buffers for every backend.
+            if (rans) {
+                Measure(std::format("{} decode", name), megabytes, "MB", [&] { decodeStreams(SbCodecMaxFOG::DecoderLUT); });
+            }
+            else {
+                for (const auto decoder : { SbCodecMaxFOG::DecoderIKP, SbCodecMaxFOG::DecoderLUT, SbCodecMaxFOG::DecoderStatic }) {
+                    Measure(std::format("{} maxfog {} decode", name, decoderNames[decoder]), megabytes, "MB", [&] { decodeStreams(decoder); });
+                }
+            }
+            // All decoders of all modes have to agree on every coefficient of the same layout.
+            std::vector<uint8_t> coefficients;
+            for (const auto decoder : { SbCodecMaxFOG::DecoderIKP, SbCodecMaxFOG::DecoderLUT, SbCodecMaxFOG::DecoderStatic }) {
+                decodeStreams(decoder);
+                auto& reference = references[(features & SbOwlVisionContainer::Zigzag) ? 1 : 0];
+                coefficients.assign(image.entity, image.entity + image.size());
+                if (reference.empty()) { reference = coefficients; }
+                if (reference != coefficients) {
+                    std::cout << "Error, entropy decoders disagree." << std::endl;
+                }
+            }
+            // Encoder alone on the same coefficients, it only reads them.
+            Measure(std::format(rans ? "{} encode" : "{} maxfog encode", name), megabytes, "MB", [&] {
+                std::stringstream encoded(std::ios::in | std::ios::out | std::ios::binary);
+                for (const auto& [offset, size] : streams) {
+                    if (rans) {
+                        SbCodecRANS::EncodeBytes(coefficients.data() + offset, coefficients.data() + offset + size, &encoded, features & SbOwlVisionContainer::BandTrees);
+                        continue;
+                    }
+                    SbCodecMaxFOG::EncodeBytes(coefficients.data() + offset, coefficients.data() + offset + size, &encoded, bitBuffer.data(),
+                                               bitBuffer.size(), fogModes);
+                }
+            });
+            Measure(std::format("{} ovc decode", name), pixels, "pixels", [&] {
+                SbOwlVisionCoreImage decoded;
+                SbOwlVisionContainer reader{ &decoded };
+                std::istringstream in(bytes, std::ios::binary);
+                reader(&in, ::operator new);
+                decoded.Deallocate(::operator delete);
+            });
+        }
+
+        // Chunked streams straight into a sink which can't seek, like a pipe or a pack builder, against a seekable stringstream.
+        // Bit buffers of 4 KiB make MaxFOG spill many times, which needed seeking back before.
+        container.features = SbOwlVisionContainer::Zigzag | SbOwlVisionContainer::ZeroRun | SbOwlVisionContainer::PlaneTrees | SbOwlVisionContainer::Chunked;
+        size_t sunk = 0;
+        Measure("chunked ovc sink encode", pixels, "pixels", [&] {
+            std::memcpy(image.entity, raw.data(), raw.size());
+            SbSinkStream sink([&](std::span<const std::byte> bytes) { sunk += bytes.size(); });
+            container(static_cast<std::ostream*>(&sink), ::operator new);
+        });
+        Measure("chunked ovc stringstream encode", pixels, "pixels", [&] {
+            std::memcpy(image.entity, raw.data(), raw.size());
+            std::stringstream out(std::ios::in | std::ios::out | std::ios::binary);
+            container(static_cast<std::ostream*>(&out), ::operator new);
+        });
+        std::memcpy(image.entity, raw.data(), raw.size());
+        std::string chunked;
+        Measure("chunked maxfog 4k buffer encode", megabytes, "MB", [&] {
+            chunked.clear();
+            SbSinkStream sink([&](std::span<const std::byte> bytes) { chunked.append(reinterpret_cast<const char*>(bytes.data()), bytes.size()); });
+            uint8_t bits[4096];
+            SbCodecMaxFOG::EncodeBytes(image.entity, image.entity + image.size(), &sink, bits, sizeof(bits), SbCodecMaxFOG::ModeChunked);
+        });
+        std::istringstream chunkedIn(chunked, std::ios::binary);
+        std::vector<uint8_t> decoded(image.size());
+        SbCodecMaxFOG::DecodeBits(decoded.data(), SbCodecMaxFOG::GetEncodedBits(&chunkedIn), &chunkedIn, bitBuffer.data(), SbCodecMaxFOG::ModeChunked);
+        if (!std::equal(decoded.begin(), decoded.end(), image.entity)) {
+            std::cout << "Error, chunked maxfog stream doesn't decode." << std::endl;
+        }
+        image.Deallocate(::operator delete);
+
+        // What every small image paid for its IKP decoders before they were cached.
+        uint8_t tree[64];
+        std::iota(std::begin(tree), std::end(tree), uint8_t(1));
+        Measure("ikp jit build", 1000, "decoders", [&] {
+            for (int i = 0; i != 1000; ++i) { SbIKPByteDecoder decoder(tree, 64); }
+        });
+        Measure("ikp cached acquire", 1000, "decoders", [&] {
+            for (int i = 0; i != 1000; ++i) { SbIKPByteDecoder::Acquire(tree, 64); }
+        });
+    }
+
+    void SbAVBenchmark::Fused() {
+        using Image = SbOwlVisionCoreImage;
+        Image image(7680, 4320);
+        image.Allocate(::operator new, Image::WithShadow);
+        std::mt19937 rng(2024);
+        // Smooth gradients with a little noise, so quantized blocks look like a photo rather than white noise.
+        for (size_t i = 0; i != image.size(); ++i) {
+            image.entity[i] = static_cast<uint8_t>(((i % image.width) >> 5) + ((i / image.width) >> 6) + (rng() & 15));
+        }
+        const std::vector<uint8_t> raw(image.entity, image.entity + image.size());
+
+        Image::ShadowOperationPipelineInfo infos[3];
+        for (uint8_t p = 0; p != 3; ++p) { image.InitShadowOperationPipelineInfo(static_cast<Image::PlaneType>(p), infos + p); }
+        const auto unfused = [&]<bool dir, bool fixedPoint>() {
+            for (const auto& pi : infos) {
+                if constexpr (fixedPoint) {
+                    image.EntityFixedProject<dir>(pi);
+                    image.ShadowFixedTransformAndQuantize<dir>(pi);
+                    image.ShadowFixedMergeBack<dir>(pi);
+                }
+                else {
+                    image.EntityNormalizedProject<dir>(pi);
+                    image.ShadowTransformAndQuantize<dir>(pi);
+                    image.ShadowMergeBack<dir>(pi);
+                }
+            }
+        };
+        const auto fused = [&]<bool dir, bool fixedPoint>() {
+            for (const auto& pi : infos) {
+                if constexpr (fixedPoint) { image.EntityFusedFixedTransformAndQuantize<dir>(pi); }
+                else                      { image.EntityFusedTransformAndQuantize<dir>(pi); }
+            }
+        };
+
+        // Both ways must leave the same bytes, forward from the picture and inverse from its coefficients.
+        const auto identical = [&]<bool fixedPoint>() {
+            std::memcpy(image.entity, raw.data(), raw.size());
+            unfused.template operator()<SbDCT::dirForward, fixedPoint>();
+            const std::vector<uint8_t> coefficients(image.entity, image.entity + image.size());
+            unfused.template operator()<SbDCT::dirInverse, fixedPoint>();
+            const std::vector<uint8_t> pixels(image.entity, image.entity + image.size());
+            std::memcpy(image.entity, raw.data(), raw.size());
+            fused.template operator()<SbDCT::dirForward, fixedPoint>();
+            const bool forward = std::equal(coefficients.begin(), coefficients.end(), image.entity);
+            fused.template operator()<SbDCT::dirInverse, fixedPoint>();
+            return forward && std::equal(pixels.begin(), pixels.end(), image.entity);
+        };
+        std::cout << std::format("{:<40s} {:>14s}\n", "float fused identical", identical.template operator()<false>() ? "yes" : "no");
+        std::cout << std::format("{:<40s} {:>14s}\n", "fixed fused identical", identical.template operator()<true>() ? "yes" : "no");
+
+        // Three pass float moves a byte in, four out, four in, four out, four in and a byte out, fixed point uses two instead of four.
+        // Fused stages only read and write the byte itself, blocks never leave L1.
+        const double samples = static_cast<double>(image.size());
+        const auto traffic = [&](std::string_view name, double rate, double bytesPerSample) {
+            std::cout << std::format("{:<40s} {:>14.2f} GB/s ({:.0f} bytes a sample)\n", name, rate * bytesPerSample / 1e9, bytesPerSample);
+        };
+        double rate = 0.0;
+        rate = Measure("float three pass forward", samples, "samples", [&] { unfused.template operator()<SbDCT::dirForward, false>(); });
+        traffic("  memory traffic", rate, 18.0);
+        rate = Measure("float three pass inverse", samples, "samples", [&] { unfused.template operator()<SbDCT::dirInverse, false>(); });
+        traffic("  memory traffic", rate, 18.0);
+        rate = Measure("float fused forward", samples, "samples", [&] { fused.template operator()<SbDCT::dirForward, false>(); });
+        traffic("  memory traffic", rate, 2.0);
+        rate = Measure("float fused inverse", samples, "samples", [&] { fused.template operator()<SbDCT::dirInverse, false>(); });
+        traffic("  memory traffic", rate, 2.0);
+        rate = Measure("fixed three pass forward", samples, "samples", [&] { unfused.template operator()<SbDCT::dirForward, true>(); });
+        traffic("  memory traffic", rate, 10.0);
+        rate = Measure("fixed three pass inverse", samples, "samples", [&] { unfused.template operator()<SbDCT::dirInverse, true>(); });
+        traffic("  memory traffic", rate, 10.0);
+        rate = Measure("fixed fused forward", samples, "samples", [&] { fused.template operator()<SbDCT::dirForward, true>(); });
+        traffic("  memory traffic", rate, 2.0);
+        rate = Measure("fixed fused inverse", samples, "samples", [&] { fused.template operator()<SbDCT::dirInverse, true>(); });
+        traffic("  memory traffic", rate, 2.0);
+        image.Deallocate(::operator delete);
+    }
+
+    void SbAVBenchmark::Threads() {
+        const std::pair<const char*, size_t> sizes[] = { { "4K", 3840 }, { "8K", 7680 } };
+        for (const auto& [label, width] : sizes) {
+            SbOwlVisionCoreImage image(width, width * 9 / 16);
+            image.Allocate(::operator new);
+            std::mt19937 rng(2024);
+            for (size_t i = 0; i != image.size(); ++i) {
+                image.entity[i] = static_cast<uint8_t>(((i % image.width) >> 5) + ((i / image.width) >> 6) + (rng() & 15));
+            }
+            const std::vector<uint8_t> raw(image.entity, image.entity + image.size());
+            const double pixels = static_cast<double>(image.width * image.height);
+            SbOwlVisionContainer container{ &image };
+
+            // The calling thread works too, so a pool of n - 1 workers runs n threads.
+            std::string firstBytes, firstPixels;
+            double      baseEncode = 0.0, baseDecode = 0.0;
+            bool        identical  = true;
+            for (size_t threads : { 1, 2, 4, 8, 16, 32 }) {
+                SbThreadPool pool(threads - 1);
+                container.pool = &pool;
+                std::string bytes;
+                const double encode = Measure(std::format("{} encode, {} threads", label, threads), pixels, "pixels", [&] {
+                    container.features = SbOwlVisionContainer::Zigzag | SbOwlVisionContainer::ZeroRun | SbOwlVisionContainer::Restart;
+                    std::memcpy(image.entity, raw.data(), raw.size());
+                    std::stringstream out(std::ios::in | std::ios::out | std::ios::binary);
+                    container(static_cast<std::ostream*>(&out), ::operator new);
+                    bytes = out.str();
+                });
+                image.Deallocate(::operator delete);
+                const double decode = Measure(std::format("{} decode, {} threads", label, threads), pixels, "pixels", [&] {
+                    SbMemoryStream in(std::as_bytes(std::span(bytes)));
+                    container(&in, ::operator new);
+                    image.Deallocate(::operator delete);
+                });
+                // Next encode starts from the picture again, in the buffer of this decode.
+                SbMemoryStream in(std::as_bytes(std::span(bytes)));
+                container(&in, ::operator new);
+                const std::string decoded(reinterpret_cast<const char*>(image.entity), image.size());
+                if (threads == 1) { firstBytes = bytes, firstPixels = decoded, baseEncode = encode, baseDecode = decode; }
+                identical = identical && bytes == firstBytes && decoded == firstPixels;
+                std::cout << std::format("{:<40s} {:>14.2f}x encode {:.2f}x decode\n", "  speedup", encode / baseEncode, decode / baseDecode);
+            }
+            container.pool = nullptr;
+            image.Deallocate(::operator delete);
+            std::cout << std::format("{} output on every thread count is {}\n", label, identical ? "identical" : "DIFFERENT");
+        }
+    }
+
+    void SbAVBenchmark::Colour() {
+        SbOwlVisionCoreImage image(3840, 2160);
+        image.Allocate(::operator new);
+        std::mt19937 rng(2024);
+        // Gradients over the whole byte range, so clamping at both ends is exercised too.
+        for (size_t i = 0; i != image.size(); ++i) {
+            image.entity[i] = static_cast<uint8_t>(((i % image.width) >> 3) + ((i / image.width) >> 2) + (rng() & 31));
+        }
+        const double pixels = static_cast<double>(image.width * image.height);
+        std::vector<uint8_t> reference(image.width * image.height * 3), out(image.width * image.height * 4);
+
+        // Per pixel float conversion every convertor used before, kept as the reference.
+        const auto perPixel = [&] {
+            const size_t u_offset = image.width * image.height, v_offset = u_offset + (u_offset >> 2), uv_width = image.width >> 1;
+            uint8_t rgba[4];
+            for (size_t y = 0; y != image.height; ++y) {
+                for (size_t x = 0; x != image.width; ++x) {
+                    const size_t c = (y >> 1) * uv_width + (x >> 1);
+                    SbSIMD::yuv2rgba(image.entity[y * image.width + x], image.entity[u_offset + c], image.entity[v_offset + c], rgba);
+                    std::memcpy(reference.data() + (y * image.width + x) * 3, rgba, 3);
+                }
+            }
+        };
+        const double base = Measure("per pixel float rgb", pixels, "pixels", perPixel);
+
+        const auto run = [&](std::string_view name, SbPixelConvertor convertor) {
+            const double rate = Measure(name, pixels, "pixels", [&] { convertor(out.data()); });
+            std::cout << std::format("{:<40s} {:>14.2f}x\n", "  speedup", rate / base);
+        };
+        run("avx2 rgb",                  { &image, SbPixelConvertor::RGB });
+        run("avx2 rgba",                 { &image, SbPixelConvertor::RGBA });
+        run("avx2 bgra",                 { &image, SbPixelConvertor::BGRA });
+        run("avx2 premultiplied rgba",   { &image, SbPixelConvertor::RGBA, 0x80, true });
+
+        // Fixed point may round the other way than float now and then, but never by more than one.
+        SbPixelConvertor{ &image, SbPixelConvertor::RGB }(out.data());
+        int    worst = 0;
+        size_t off   = 0;
+        for (size_t i = 0; i != reference.size(); ++i) {
+            const int d = std::abs(int(out[i]) - int(reference[i]));
+            worst = std::max(worst, d);
+            off  += d != 0;
+        }
+        std::cout << std::format("{:<40s} {:>14d} ({:.3f}% of channels off)\n", "largest difference to float", worst, 100.0 * off / reference.size());
+        image.Deallocate(::operator delete);
+    }
+
+}
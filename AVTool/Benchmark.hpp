@@ -0,0 +1,39 @@
+///
+/// \file      Benchmark.hpp
+/// \brief     Micro benchmarks for SubAV core kernels (Hidden command, for developers).
+/// \author    HenryDu
+/// \date      10.16.2026
+/// \copyright © HenryDu 2026. All right reserved.
+///
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+namespace SubIT {
+
+    class SbAVBenchmark {
+    public:
+        // Run the closure several times and print how many units it processed per second.
+        template <class Fn>
+        static double Measure(std::string_view name, double units, std::string_view unitName, Fn&& fn);
+
+        // Dispatch by suite name, input is only used by suites which need a real file.
+        static void Run(std::string_view suite, std::string_view input);
+
+        static void DCT8x8();
+        // Coefficients per second of every block size, to compare big blocks against 8x8.
+        static void DCTSizes();
+        // Decode and encode one ovc file with the float and the fixed point pipeline.
+        static void Pipeline(std::string_view ovc);
+        // Write one ovc file again with every coefficient layout and MaxFOG mode, compare sizes and decoding.
+        static void Entropy(std::string_view ovc);
+        // Three pass against fused transform and quantize stages on a synthetic 8K picture, with the memory they move.
+        static void Fused();
+        // Encode and decode of synthetic 4K and 8K pictures on pools of 1 to 32 threads, output has to stay the same.
+        static void Threads();
+        // Per pixel float YUV to RGB against the AVX2 fixed point convertors on a synthetic 4K picture.
+        static void Colour();
+    };
+
+}
@@ -10,11 +10,13 @@
 
 #include "../AVCore/RGBA.hpp"
 #include "../AVCore/OwlVision.hpp"
+#include "../AVCore/MemoryStream.hpp"
 #include "../AVCore/MacaqueMixture.hpp"
 #include "../AVCore/DolphinAudition.hpp"
 
 #include "PPM.hpp"
 #include "FFmpeg.hpp"
+#include "Benchmark.hpp"
 
 namespace SubIT {
     class SbAVTool {
@@ -33,6 +35,13 @@ Part of SubAV SDK, a tool for ovc, dac, mmc generation.
 Following commands are available (You should at least have three arguments):
 
 -ovg : Follows an image (JPEG, PNG, etc.)  and generate a ovc file.
+-ovx : Same as -ovg, but codes coefficients block by block with zero runs (much smaller),
+       with per plane and per band trees, and restart points for parallel entropy coding.
+-ovd : Same as -ovx without per band trees, and every region picks its own dct block size (VarDCT).
+-ovr : Same as -ovx, but coefficients go through rANS instead of MaxFOG (smaller, slower).
+-ovt : Same as -ovx, but cut into 256x256 tiles so any region decodes on its own.
+-ovp : Same as -ovx, but progressive: DC of every block first, then low and high frequencies.
+-ovs : Same as -ovx, but coded 16 rows at a time, memory doesn't grow with the height of the image.
 -dag : Follows an audio (MP3, OGG etc.) and generate a dac file (WIP).
 -mmg : Follows a  video (MP4, MOV etc.) and generate a MMC file (WIP).
 -ovv : Follows an ovc image -- view it.
@@ -55,7 +64,7 @@ Addition thanks to Xincheng Hao who inspired us to do this project and created a
             std::cout << message;
         }
 
-        static void MakeOVC(std::string_view filename, std::string_view tmp) {
+        static void MakeOVC(std::string_view filename, std::string_view tmp, uint32_t features = 0) {
             using namespace std::string_literals;
             // We will create both property description and raw stream. 
             SbFFMpegCommander::YUVCreateStream(filename, tmp);
@@ -67,26 +76,37 @@ Addition thanks to Xincheng Hao who inspired us to do this project and created a
             
             std::ifstream input(yuvTmpName, std::ios::binary);
             SbFFMpegCommander::OwlVisionFillDesc(&image, tmp);
-            image.Allocate(::operator new);
 
             if (!image.SatisfyRestriction()) {
                 std::cout << "Error, your data's width and height must all divisible by 16!" << std::endl;
                 return;
             }
-            input.read(reinterpret_cast<char*>(image.entity), image.size());
+            // Strips are read from the yuv file one by one, the whole image is never in memory.
+            const bool strips = features & SbOwlVisionContainer::Strips;
+            if (!strips) {
+                image.Allocate(::operator new);
+                input.read(reinterpret_cast<char*>(image.entity), image.size());
+            }
             
             // Create a standalone image.
             std::ofstream output(std::string(tmp) + ".ovc"s, std::ios::binary);
 
             auto start = std::chrono::high_resolution_clock::now();
             SbOwlVisionContainer factory{ &image };
-            factory(&output, ::operator new);
+            factory.features = features;
+            if (strips) {
+                SbOwlVisionStripWriter writer(&factory, &output);
+                writer.Write(&input);
+            }
+            else {
+                factory(&output, ::operator new);
+            }
             auto stop = std::chrono::high_resolution_clock::now();
 
             std::cout << "Totoal compression time used: ";
             std::cout << std::format("{}s\n", std::chrono::duration<float>(stop - start).count());
 
-            image.Deallocate(::operator delete);
+            if (!strips) { image.Deallocate(::operator delete); }
             // Clear all temporary files.
             output.close();
             input.close();
@@ -137,9 +157,9 @@ Addition thanks to Xincheng Hao who inspired us to do this project and created a
             SbOwlVisionCoreImage image;
             SbOwlVisionContainer factory{ &image };
     
-            std::ifstream inovc(filename.data(), std::ios::binary);
+            SbMappedFile inovc(filename);
             std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
-            factory(&inovc, ::operator new);
+            factory(inovc.Bytes(), ::operator new);
             auto stop = std::chrono::high_resolution_clock::now();
     
             std::cout << "Totoal uncompression time: ";
@@ -168,19 +188,25 @@ Addition thanks to Xincheng Hao who inspired us to do this project and created a
             SbOwlVisionCoreImage image;
             SbOwlVisionContainer factory{ &image };
 
-            std::ifstream inovc(filename.data(), std::ios::binary);
+            SbMappedFile  inovc(filename);
             std::ofstream oppm(std::format("{:s}.ppm", tmp));
 
-            factory(&inovc, ::operator new);
+            factory(inovc.Bytes(), ::operator new);
 
+            // A band of rows at a time, the whole picture in RGB would be twice the image again.
+            constexpr size_t     bandRows = 16;
+            std::vector<uint8_t> band(image.width * bandRows * 3);
             SbRGB rgb{ &image };
-            rgb(reinterpret_cast<uint8_t*>(image.shadow));
-            SbPPM ppm{ reinterpret_cast<uint8_t*>(image.shadow), image.width, image.height };
-            ppm(&oppm);
+            SbPPM ppm{ nullptr, static_cast<uint16_t>(image.width), static_cast<uint16_t>(image.height) };
+            ppm.WriteHeader(&oppm);
+            for (size_t y = 0; y < image.height; y += bandRows) {
+                const size_t rows = std::min(bandRows, image.height - y);
+                rgb(band.data(), y, rows);
+                SbPPM::WritePixels(&oppm, band.data(), image.width * rows);
+            }
 
             std::cout << "Conversion complete!" << std::endl;
 
-            inovc.close();
             oppm .close();
             image.Deallocate(::operator delete);
         }
@@ -192,13 +218,29 @@ Addition thanks to Xincheng Hao who inspired us to do this project and created a
             std::string tmp      = filename.substr(0,filename.find_last_of('.'));
 
             if (command == "-ovg")    { MakeOVC(filename, tmp); return; }
+            constexpr uint32_t ovx = SbOwlVisionContainer::Zigzag | SbOwlVisionContainer::ZeroRun | SbOwlVisionContainer::Restart
+                                   | SbOwlVisionContainer::PlaneTrees | SbOwlVisionContainer::BandTrees;
+            if (command == "-ovx")    { MakeOVC(filename, tmp, ovx); return; }
+            // Band trees only know 8x8 blocks.
+            if (command == "-ovd")    { MakeOVC(filename, tmp, (ovx & ~SbOwlVisionContainer::BandTrees) | SbOwlVisionContainer::VarDCT); return; }
+            if (command == "-ovr")    { MakeOVC(filename, tmp, ovx | SbOwlVisionContainer::RANS); return; }
+            if (command == "-ovt")    { MakeOVC(filename, tmp, ovx | SbOwlVisionContainer::Tiled); return; }
+            if (command == "-ovp")    { MakeOVC(filename, tmp, ovx | SbOwlVisionContainer::Progressive); return; }
+            if (command == "-ovs")    { MakeOVC(filename, tmp, ovx | SbOwlVisionContainer::Strips); return; }
             if (command == "-dag")    { MakeDAC(filename, tmp); return; }
             if (command == "-mmg")    { MakeMMC(filename, tmp); return; }
             if (command == "-ovppm")  { MakePPM(filename, tmp); return; } // Hidden command, users don't know its existence.
             if (command == "-ovv")    { ViewOVC(filename, tmp); return; }
             if (command == "-dav")    { ViewDAC(filename, tmp); return; }
             if (command == "-mmv")    { ViewMMC(filename, tmp); return; }
+            if (command == "-bench")  { SbAVBenchmark::Run(filename, ""); return; } // Hidden command, for developers.
+
+            std::cout << "Error, invalid arguments, please check help messages." << std::endl;
+        }
 
+        // Execute when command case is equal to 4, only benchmarks need a suite name and an input.
+        void OperateBenchmark() const {
+            if (args[1] == "-bench") { SbAVBenchmark::Run(args[2], args[3]); return; } // Hidden command, for developers.
             std::cout << "Error, invalid arguments, please check help messages." << std::endl;
         }
 
@@ -209,6 +251,7 @@ Addition thanks to Xincheng Hao who inspired us to do this project and created a
             case 1:
             case 2: PrintHelpMessage(); break;
             case 3: OperateFile(); break;
+            case 4: OperateBenchmark(); break;
             }
         }
     };
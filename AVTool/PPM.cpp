@@ -17,11 +17,19 @@
 namespace SubIT {
 
     void SbPPM::operator()(std::ostream* os) {
+        WriteHeader(os);
+        WritePixels(os, data, static_cast<size_t>(width) * height);
+    }
+
+    void SbPPM::WriteHeader(std::ostream* os) const {
         std::string header = std::format("P3 {:d} {:d} {:d} ", width, height, max);
         os->write(header.c_str(), static_cast<size_t>(header.size()));
+    }
+
+    void SbPPM::WritePixels(std::ostream* os, const uint8_t* rgb, size_t count) {
         char buffer[12] = "";
-        for (size_t i = 0; i != (width * height * 3); i += 3) {
-            auto end = std::format_to(buffer, "{:d} {:d} {:d} ", data[i], data[i + 1], data[i + 2]);
+        for (size_t i = 0; i != count * 3; i += 3) {
+            auto end = std::format_to(buffer, "{:d} {:d} {:d} ", rgb[i], rgb[i + 1], rgb[i + 2]);
             os->write(buffer, static_cast<size_t>(end - buffer));
         }
     }
@@ -19,5 +19,8 @@ namespace SubIT {
 
         void operator()(std::ostream* os);
         void operator()(std::istream* is);
+        // Same output as above in pieces, the header first and then any number of pixels (3 bytes each) at a time.
+        void WriteHeader(std::ostream* os) const;
+        static void WritePixels(std::ostream* os, const uint8_t* rgb, size_t count);
     };
 }
\ No newline at end of file